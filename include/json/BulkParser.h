@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "json/Document.h"
+
+namespace json
+{
+
+/**
+ * Parses large buffers of newline-delimited JSON (NDJSON) in parallel
+ *
+ * The input is split into one chunk per thread at record boundaries. Every
+ * non-empty line holds exactly one record. Records appear in the output in
+ * the same order as in the input.
+ */
+class BulkParser
+{
+public:
+    /**
+     * \param num_threads
+     *      How many threads to parse on. Zero uses one thread per core.
+     * \param options
+     *      Applied to every record
+     */
+    explicit BulkParser(size_t num_threads = 0,
+                        const ParseOptions &options = ParseOptions());
+
+    /**
+     * Parse every record into its own document
+     *
+     * \throws json_error if any record is not valid JSON
+     */
+    std::vector<Document> parse(std::string_view input) const;
+
+    /**
+     * Parse every record and append it to output
+     *
+     * Each record is prefixed with its length, like Document::compress
+     * does, so that it can be read back with Document(bitstream&).
+     *
+     * \throws json_error if any record is not valid JSON
+     */
+    void parse(std::string_view input, bitstream &output) const;
+
+    /**
+     * Parse only the records that match the predicates
+     *
+     * The predicates use the same syntax as Document::matches_predicates.
+     * Only the fields they refer to are read from the text of a record.
+     * Records that do not match are dropped without encoding the rest.
+     *
+     * \throws json_error if any record is not valid JSON
+     */
+    std::vector<Document> parse(std::string_view input,
+                                const Document &predicates) const;
+
+    /**
+     * Append only the records that match the predicates to output
+     *
+     * \see parse(std::string_view, const Document&)
+     */
+    void parse(std::string_view input, const Document &predicates,
+               bitstream &output) const;
+
+    /**
+     * Parse a single document whose top-level value is a large array
+     *
+     * The elements are split into one range per thread, parsed into
+     * separate buffers and then joined into a single array. Any other
+     * input is parsed like Document::parse does.
+     *
+     * \throws json_error if the input is not valid JSON
+     */
+    Document parse_array(std::string_view input) const;
+
+private:
+    std::vector<std::string_view> split(std::string_view input) const;
+
+    size_t num_chunks(size_t input_size) const;
+
+    size_t m_num_threads;
+    const ParseOptions m_options;
+};
+
+} // namespace json
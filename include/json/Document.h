@@ -1,10 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
+#include <span>
 #include <stdbitstream.h>
+#include <string_view>
 
 #include "json/Diff.h"
 #include "json/Iterator.h"
+#include "json/ParseError.h"
+#include "json/Path.h"
 #include "json/defines.h"
 
 #ifdef USE_GEO
@@ -14,6 +21,23 @@
 namespace json
 {
 
+class ChildIndex;
+class ChildIterator;
+class PathIndex;
+
+/**
+ * Maps and arrays with at least this many children get a ChildIndex on
+ * first positional access
+ */
+constexpr uint32_t CHILD_INDEX_THRESHOLD = 32;
+
+/**
+ * Default size above which Document::sort_map_keys sorts a map
+ *
+ * Smaller maps are scanned about as fast as they are searched.
+ */
+constexpr uint32_t SORTED_MAP_THRESHOLD = 16;
+
 class Document
 {
 public:
@@ -34,6 +58,14 @@ public:
      */
     Document(const Document &parent, const std::string &path, bool force = false);
 
+    /**
+     * Create a view of the value at a compiled path
+     *
+     * This is faster than passing the path as a string, as it only visits the
+     * values on the path.
+     */
+    Document(const Document &parent, const Path &path, bool force = false);
+
     /**
      * Creates an empty and invalid object
      */
@@ -46,6 +78,39 @@ public:
      */
     explicit Document(const std::string &str);
 
+    /**
+     * Creates an object from JSON text
+     *
+     * The input is parsed in place; it is never copied and does not need to
+     * be null-terminated.
+     */
+    static Document parse(std::string_view str);
+    static Document parse(const char *data, size_t length);
+
+    /**
+     * Creates an object from JSON text, but only keeps the given paths
+     *
+     * Produces the same result as Document(Document::parse(str), paths),
+     * except that empty input gives null like parse(str) does. Everything
+     * that is not on one of the paths is skipped without being decoded. If a
+     * wildcard is below a key that appears more than once in a map, the whole
+     * input is parsed and projected instead.
+     */
+    static Document parse(std::string_view str,
+                          const std::vector<std::string> &paths);
+
+    /**
+     * Parse JSON text into result without throwing on malformed input
+     *
+     * Unlike parse(), this rejects anything but whitespace after the value.
+     * Result is left empty if the input is malformed.
+     *
+     * \returns the code, position and context of the first error, or an
+     *          error that converts to false if parsing succeeded
+     */
+    static ParseError try_parse(std::string_view str, Document &result,
+                                const ParseOptions &options = ParseOptions());
+
 #ifndef IS_ENCLAVE
     /**
      * Load from a binary file
@@ -56,12 +121,38 @@ public:
     Document(const uint8_t *data, uint32_t length, DocumentMode mode);
     Document(uint8_t *data, uint32_t length, DocumentMode mode);
 
-    ~Document() = default;
+    ~Document();
 
-    void assign(bitstream &&data) { m_content = std::move(data); }
+    void assign(bitstream &&data)
+    {
+        invalidate_indexes();
+        m_content = std::move(data);
+    }
 
+    /**
+     * Check that the top-level value fits into the content
+     *
+     * \see validate
+     */
     bool valid() const;
 
+    /**
+     * Check the entire document before it is read
+     *
+     * Unlike valid(), this checks every type, size and length, so that
+     * reading a document that passes never leaves its buffer. Use it for
+     * documents from untrusted sources, e.g. those created from a bitstream
+     * or with DocumentMode::ReadOnly. The check is a single pass that does
+     * not allocate. Documents that pass are marked as trusted, so checking
+     * them again is free until their content is changed.
+     */
+    bool validate() const;
+
+    /**
+     * Whether validate() succeeded since the content was last changed
+     */
+    bool trusted() const { return m_trusted.load(std::memory_order_acquire); }
+
     bool empty() const { return get_type() == ObjectType::Null; }
 
     ObjectType get_type() const;
@@ -79,11 +170,57 @@ public:
 
     const uint8_t* as_binary() const;
     std::string as_string() const;
+
+    /**
+     * Get the value of a string without copying it
+     *
+     * The view points into the document, so it is only valid as long as the
+     * document is neither changed nor destroyed.
+     *
+     * \throws json_error if this is not a string
+     */
+    std::string_view as_string_view() const;
+
+    /**
+     * Get the content of a binary object without copying it
+     *
+     * \see as_string_view
+     */
+    std::span<const uint8_t> as_binary_span() const;
     integer_t as_integer() const;
     float_t as_float() const;
     bool as_boolean() const;
+
+    /**
+     * Get the value of a datetime
+     *
+     * This also accepts datetimes in the old encoding.
+     */
+    timestamp_t as_timestamp() const;
     bitstream as_bitstream() const;
 
+    /**
+     * Get the values of a typed array of integers without copying them
+     *
+     * The span points into the document, so it is only valid as long as the
+     * document is not changed. Use summarize() for fast reductions.
+     *
+     * Writer aligns the values relative to the start of the document. They
+     * are no longer aligned in a copy of a view or after an insertion in
+     * front of them. The values are then copied once, and the span points
+     * to that copy, which takes extra memory until the document changes.
+     *
+     * \throws json_error if this is not a typed array of integers
+     */
+    std::span<const integer_t> as_integer_span() const;
+
+    /**
+     * Get the values of a typed array of floats without copying them
+     *
+     * \see as_integer_span
+     */
+    std::span<const float_t> as_float_span() const;
+
     /**
      * Add to or create the specified field
      *
@@ -94,6 +231,8 @@ public:
     /**
      * Get the key of the n-th child
      *
+     * Like get_child, this takes constant time for large maps.
+     *
      * \note This is only supported for maps
      *
      * \throws invalid_argument if the position is out of bounds
@@ -101,9 +240,24 @@ public:
      */
     std::string get_key(size_t pos) const;
 
+    /**
+     * Get the key of the n-th child without copying it
+     *
+     * Keys that are stored in a key dictionary point into the dictionary,
+     * which is part of the document as well.
+     *
+     * \see get_key
+     * \see as_string_view
+     */
+    std::string_view key_view(size_t pos) const;
+
     /**
      * Returns a read-only view of the child as position pos
      *
+     * The first call on a map or array with CHILD_INDEX_THRESHOLD or more
+     * children records the offsets of all of them, which makes every later
+     * call take constant time. Smaller containers are searched linearly.
+     *
      * \note This is only supported for arrays and maps
      *
      * \throws invalid_argument if the position is out of bounds
@@ -111,27 +265,99 @@ public:
      */
     json::Document get_child(size_t pos) const;
 
+    /**
+     * Iterate over the children of a map or array
+     *
+     * Each step moves past one child using its encoded size, so a loop over
+     * all children takes linear time. Entries hold a view of the key and,
+     * usually, of the child, which are only valid as long as this document is
+     * not changed. Arrays yield empty keys.
+     *
+     * Maps and arrays in a document with a key dictionary cannot be read
+     * without it. Each dereference then allocates a copy of the child along
+     * with the whole dictionary, like get_child() does. Expand the keys with
+     * use_key_dictionary(false) first when iterating over many such children.
+     *
+     * \throws json_error if document is not a map or array
+     */
+    ChildIterator begin() const;
+    ChildIterator end() const;
+
+    /**
+     * Get read-only views of the values at several paths at once
+     *
+     * All paths are found in a single pass over the document, which only
+     * visits the values on one of them.
+     *
+     * \returns one document per path, in the order they were given to the
+     *          set, which is empty if the path was not found
+     */
+    std::vector<Document> lookup(const PathSet &paths) const;
+
     bool matches_predicates(const json::Document &predicates) const;
 
+    /**
+     * Record where every value of the document is by its path
+     *
+     * Afterwards, views by path, including those made to check predicates,
+     * are found with a single hash table probe instead of a search. This is
+     * meant for documents that are queried many times. Every value takes 40
+     * to 90 bytes plus the length of its path, see path_index_memory().
+     * Like the child index, the path index is dropped when the content is
+     * modified.
+     */
+    void build_path_index() const;
+
+    bool has_path_index() const { return m_path_index.load() != nullptr; }
+
+    /**
+     * Bytes held by the path index, or zero if there is none
+     */
+    size_t path_index_memory() const;
+
     void iterate(Iterator &iterator) const;
 
+    /**
+     * Get the content for reading
+     *
+     * There is no non-const overload; use mutable_data() to change the
+     * content.
+     */
     const bitstream &data() const { return m_content; }
 
-    bitstream &data() { return m_content; }
+    /**
+     * Get the content for modification
+     *
+     * This drops the indexes and the result of validate(), as the caller
+     * might change the content.
+     */
+    bitstream &mutable_data()
+    {
+        invalidate_indexes();
+        return m_content;
+    }
 
-    void operator=(Document &&other) { m_content = std::move(other.m_content); }
+    void operator=(Document &&other);
 
     /**
      * Discard contents of the document
      */
-    void clear() { m_content.clear(); }
+    void clear()
+    {
+        invalidate_indexes();
+        m_content.clear();
+    }
 
     /**
      * Returns a 64-bit hash of the content of this document
      */
     int64_t hash() const;
 
-    void detach_data(uint8_t *&data, uint32_t &len) { m_content.detach(data, len); }
+    void detach_data(uint8_t *&data, uint32_t &len)
+    {
+        invalidate_indexes();
+        m_content.detach(data, len);
+    }
 
     /**
      * Create an identical copy of this document
@@ -141,10 +367,74 @@ public:
      */
     Document duplicate(bool force_copy = false) const;
 
+    /**
+     * Insert doc at path, creating missing maps along the way
+     *
+     * \returns false if nothing was inserted. This is also the case if the
+     *          path runs through a sorted map, a typed array or a document
+     *          with a key dictionary, as those cannot be changed in place.
+     */
     bool insert(const std::string &path, const json::Document &doc);
 
+    /**
+     * Replace all datetimes in the old encoding, which stores a whole struct
+     * tm, with compact timestamps
+     *
+     * \returns the number of datetimes that were replaced
+     */
+    size_t convert_datetimes();
+
+    /**
+     * Re-encode all maps with at least min_size entries as sorted maps
+     *
+     * Keys of sorted maps are found with a binary search instead of a linear
+     * scan. Smaller maps are written as regular maps, so zero turns all
+     * sorted maps back into regular ones. Keys that are stored in a key
+     * dictionary are written inline again. insert() fails on paths through
+     * a sorted map until it is turned back into a regular one.
+     *
+     * \see Writer::set_sorted_map_threshold
+     */
+    void sort_map_keys(uint32_t min_size = SORTED_MAP_THRESHOLD);
+
+    /**
+     * Re-encode the document so that every distinct key is stored only once
+     *
+     * Maps then refer to their keys by a small id, which makes documents with
+     * many maps of the same shape considerably smaller. Search and Projection
+     * translate a path into ids once and compare those instead of strings.
+     * Sorted maps are not kept, and insert() returns false on such
+     * documents. Passing false expands all keys again.
+     *
+     * \see Writer::set_key_dictionary
+     */
+    void use_key_dictionary(bool enabled = true);
+
+    /**
+     * Whether the document stores its keys in a dictionary
+     */
+    bool uses_key_dictionary() const;
+
     void compress(bitstream &bstream) const;
 
+    /**
+     * Append the document to result in the compact wire format
+     *
+     * Lengths, counts and integers are written as varints. Small integers
+     * and the sizes of short strings, small maps and small arrays are packed
+     * into the type byte. This is meant for sending and storing documents;
+     * they have to be converted back with from_compact() to be read. Sorted
+     * maps and key dictionaries are not kept.
+     */
+    void to_compact(bitstream &result) const;
+
+    /**
+     * Read a document that was written by to_compact()
+     *
+     * \throws json_error if the data is not a valid compact document
+     */
+    static Document from_compact(const uint8_t *data, uint32_t length);
+
     /**
      * Returns a compact human-readable JSON string that holds the contents of this document
      */
@@ -163,7 +453,102 @@ public:
     Diffs diff(const Document &other) const;
 
 protected:
+    /**
+     * Drop everything that was derived from the content
+     *
+     * Must be called before the content is modified.
+     */
+    void invalidate_indexes();
+
     bitstream m_content;
+
+private:
+    /**
+     * Get the child index if the top-level container is large enough
+     *
+     * It is built on first use. Concurrent readers may both build one; only
+     * the first to finish gets to keep it.
+     */
+    const ChildIndex *child_index(uint32_t size) const;
+
+    mutable std::atomic<const ChildIndex *> m_child_index = nullptr;
+    mutable std::atomic<const PathIndex *> m_path_index = nullptr;
+
+    /// Values of a typed array that is not aligned, see as_integer_span()
+    mutable std::atomic<const void *> m_aligned_copy = nullptr;
+
+    mutable std::atomic<bool> m_trusted = false;
+
+    friend class ChildIterator;
+};
+
+/**
+ * Iterator over the children of a Document
+ *
+ * Entries are created on dereference, so this is a forward iterator in the
+ * sense of std::forward_iterator, but an input iterator to algorithms that
+ * expect dereferencing to return a reference.
+ */
+class ChildIterator
+{
+public:
+    struct Entry
+    {
+        std::string_view key;
+        Document value;
+    };
+
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Entry;
+    using reference = Entry;
+    using difference_type = std::ptrdiff_t;
+
+    ChildIterator() = default;
+
+    /**
+     * Get the key and a view of the current child
+     *
+     * Children of a document with a key dictionary that may refer to it are
+     * copied together with the dictionary instead, which takes time linear
+     * in the size of both. Elements of typed arrays are copied as well.
+     */
+    Entry operator*() const;
+
+    ChildIterator &operator++();
+
+    ChildIterator operator++(int)
+    {
+        auto previous = *this;
+        ++(*this);
+        return previous;
+    }
+
+    bool operator==(const ChildIterator &other) const
+    {
+        return m_document == other.m_document && m_index == other.m_index;
+    }
+
+private:
+    friend class Document;
+
+    ChildIterator(const Document &document, bool at_end);
+
+    const Document *m_document = nullptr;
+
+    /// Where the key dictionary starts, right after its type, or zero
+    uint32_t m_dictionary = 0;
+
+    /// Where the current child starts, at its key for maps
+    uint32_t m_offset = 0;
+
+    uint32_t m_index = 0;
+    uint32_t m_size = 0;
+
+    ObjectType m_type = ObjectType::Null;
+
+    /// Only set for typed arrays
+    ObjectType m_element_type = ObjectType::Null;
 };
 
 /**
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "json/Document.h"
+#include "json/ParseError.h"
+
+namespace json
+{
+
+class IndexedParser;
+
+/**
+ * Parses many JSON texts, one after another, into recycled buffers
+ *
+ * The parser keeps its scratch memory between calls: the structural index,
+ * the state of the writer and the buffers for decoded strings. If the target
+ * document or bitstream is reused as well, parsing inputs of a similar size
+ * does not allocate once all buffers have grown large enough.
+ *
+ * An instance must not be used by multiple threads at the same time.
+ */
+class DocumentParser
+{
+public:
+    explicit DocumentParser(const ParseOptions &options = ParseOptions());
+    ~DocumentParser();
+
+    /**
+     * Parse str and replace the contents of doc with it
+     *
+     * The buffer of doc is kept, and room for at least str.size() bytes is
+     * reserved before parsing starts.
+     *
+     * \throws json_error if the input is not valid JSON; the contents of
+     *         doc are undefined after that
+     */
+    void parse(std::string_view str, Document &doc);
+
+    /**
+     * Parse str and write it to output at the current position
+     *
+     * \throws json_error if the input is not valid JSON
+     */
+    void parse(std::string_view str, bitstream &output);
+
+    /**
+     * Like parse(str, doc), but reports malformed input instead of throwing
+     *
+     * Anything but whitespace after the value is reported as an error, while
+     * parse() ignores it. The input is indexed and parsed one window at a
+     * time, and only room for one window is reserved in doc up front, so
+     * the cost of a rejection is roughly that of parsing up to the error.
+     * The message of the error is never built from the whole input. doc is
+     * left empty if there is an error.
+     *
+     * \returns an error that converts to false if parsing succeeded
+     */
+    ParseError try_parse(std::string_view str, Document &doc);
+
+private:
+    void parse(std::string_view str, bitstream &output, size_t capacity);
+
+    const ParseOptions m_options;
+    std::unique_ptr<IndexedParser> m_parser;
+};
+
+} // namespace json
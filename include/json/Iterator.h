@@ -20,5 +20,14 @@ public:
     virtual void handle_array_end() = 0;
     virtual void handle_binary(const std::string &key, const uint8_t *data, uint32_t size) = 0;
     virtual void handle_datetime(const std::string &key, const tm &value) = 0;
+
+    /**
+     * Called for datetimes
+     *
+     * By default, this converts the value to local time in its time zone and
+     * calls handle_datetime(). Fractions of a second and the time zone are
+     * lost that way.
+     */
+    virtual void handle_timestamp(const std::string &key, const timestamp_t &value);
 };
 } // namespace json
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+
+namespace json
+{
+
+/**
+ * Why JSON text could not be parsed
+ */
+enum class ParseErrorCode : uint8_t
+{
+    None,
+    InvalidValue,
+    InvalidLiteral,
+    InvalidNumber,
+    NumberOutOfRange,
+    InvalidString,
+    InvalidEscape,
+    InvalidDatetime,
+    InvalidMap,
+    InvalidArray,
+    UnexpectedEnd,
+    InputTooLarge,
+    InvalidUtf8,
+    TrailingInput
+};
+
+/**
+ * Get a short description of an error code
+ */
+const char *error_message(ParseErrorCode code);
+
+/**
+ * Where and why parsing failed
+ *
+ * Lines and columns start at one. Columns count bytes, not characters.
+ */
+struct ParseError
+{
+    ParseErrorCode code = ParseErrorCode::None;
+
+    /// Position of the error as a byte offset into the input
+    size_t offset = 0;
+
+    size_t line = 0;
+    size_t column = 0;
+
+    /// A few bytes of input around the error
+    std::string snippet;
+
+    explicit operator bool() const { return code != ParseErrorCode::None; }
+};
+
+/**
+ * Settings for parsing JSON text
+ */
+struct ParseOptions
+{
+    /**
+     * Reject input that is not valid UTF-8
+     *
+     * The check is done while the structural index is built, so it reads
+     * every byte only once. Off by default, in which case strings may
+     * contain arbitrary bytes.
+     */
+    bool validate_utf8 = false;
+};
+
+} // namespace json
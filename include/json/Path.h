@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json
+{
+
+/**
+ * A path that is split into its keys once, so that it can be looked up in
+ * many documents
+ *
+ * Use it with Document(parent, path) like a path string. The lookup only
+ * descends along the path and skips everything else by its encoded size,
+ * without allocating.
+ *
+ * \note Wildcards are not supported
+ */
+class Path
+{
+public:
+    /**
+     * \throws json_error if the path holds an empty key or a wildcard
+     */
+    explicit Path(std::string_view path);
+
+    /**
+     * The path this was created from
+     */
+    const std::string &str() const { return m_path; }
+
+    /**
+     * The number of keys in the path
+     *
+     * An empty path refers to the entire document.
+     */
+    size_t size() const { return m_segments.size(); }
+
+    std::string_view key(size_t pos) const
+    {
+        const auto &segment = m_segments[pos];
+        return std::string_view(m_path).substr(segment.offset, segment.length);
+    }
+
+    /**
+     * Whether the key at pos can be used as a position in an array
+     */
+    bool is_index(size_t pos) const { return m_segments[pos].is_index; }
+
+    /**
+     * The key at pos as a position in an array
+     *
+     * \note Only valid if is_index(pos) holds
+     */
+    uint32_t index(size_t pos) const { return m_segments[pos].index; }
+
+private:
+    struct Segment
+    {
+        uint32_t offset;
+        uint32_t length;
+        uint32_t index;
+        bool is_index;
+    };
+
+    std::string m_path;
+    std::vector<Segment> m_segments;
+};
+
+/**
+ * A set of paths that are looked up together
+ *
+ * The paths are stored as a prefix tree, so that Document::lookup() can find
+ * all of them in a single pass, and visits shared prefixes only once.
+ *
+ * \note Wildcards are not supported
+ */
+class PathSet
+{
+public:
+    /**
+     * \throws json_error if a path holds an empty key or a wildcard
+     */
+    explicit PathSet(const std::vector<std::string> &paths);
+
+    /**
+     * The number of paths, including duplicates
+     */
+    size_t size() const { return m_size; }
+
+private:
+    friend class PathSetSearch;
+
+    struct Node
+    {
+        std::string key;
+        uint32_t index = 0;
+        bool is_index = false;
+
+        /// Positions in the trie
+        std::vector<uint32_t> children;
+
+        /// Positions in the list of paths of the paths that end here
+        std::vector<uint32_t> targets;
+    };
+
+    /// The root is the first node
+    std::vector<Node> m_nodes;
+    size_t m_size;
+};
+
+} // namespace json
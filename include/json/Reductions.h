@@ -0,0 +1,48 @@
+#pragma once
+
+#include <limits>
+#include <span>
+
+#include "json/defines.h"
+
+namespace json
+{
+
+/**
+ * Sum, minimum, maximum and count of a numeric array
+ */
+template<typename T>
+struct Summary
+{
+    /// Integers wrap around on overflow
+    T sum = 0;
+
+    /// Infinity for floats, or the largest integer, if there are no values
+    T min = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity()
+                                                 : std::numeric_limits<T>::max();
+
+    /// Negative infinity for floats, or the smallest integer, if there are no values
+    T max = std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity()
+                                                 : std::numeric_limits<T>::lowest();
+
+    /// Number of values that were included. NaN floats are skipped.
+    size_t count = 0;
+};
+
+/**
+ * Compute all aggregates in a single pass
+ *
+ * Four values are processed at a time if the CPU supports AVX2. This is
+ * meant for the values of typed arrays, see Document::as_integer_span().
+ */
+Summary<integer_t> summarize(std::span<const integer_t> values);
+
+/**
+ * Compute all aggregates in a single pass
+ *
+ * Floats are added in a different order than a plain loop does, so the sum
+ * may differ in its last bits.
+ */
+Summary<float_t> summarize(std::span<const float_t> values);
+
+} // namespace json
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include "json/Document.h"
+#include "json/Writer.h"
+
+namespace json
+{
+
+class StringDecoder;
+
+/**
+ * Incremental parser for JSON text that arrives in chunks
+ *
+ * The input may be split at any position, including in the middle of strings
+ * and numbers. Values are written to the binary format as soon as they are
+ * complete, so only tokens that span two chunks are buffered. Every top-level
+ * value becomes its own document once it has been fully parsed.
+ */
+class StreamParser
+{
+public:
+    StreamParser();
+    ~StreamParser();
+
+    /**
+     * Parse the next chunk of input
+     *
+     * The chunk is not needed after this function returns.
+     *
+     * \throws json_parse_error if the input is not valid JSON; the parser
+     *         cannot be used after that
+     */
+    void feed(const char *data, size_t length);
+    void feed(std::string_view data) { feed(data.data(), data.size()); }
+
+    /**
+     * Signal that there is no more input
+     *
+     * This completes a number at the end of the input, which could otherwise
+     * still be continued by the next chunk.
+     *
+     * \throws json_parse_error if the input ends inside of a value
+     */
+    void finish();
+
+    /**
+     * Are there documents that have been parsed but not yet retrieved?
+     */
+    bool has_document() const { return !m_documents.empty(); }
+
+    /**
+     * Retrieve the oldest parsed document
+     */
+    Document next_document();
+
+private:
+    enum class State
+    {
+        Value,
+        FirstValue,
+        Key,
+        FirstKey,
+        Colon,
+        Separator
+    };
+
+    enum class Token
+    {
+        None,
+        String,
+        Key,
+        Number,
+        Literal,
+        Datetime
+    };
+
+    const char *start_value(const char *pos, const char *end);
+    const char *start_token(Token token, const char *pos, const char *end);
+    const char *continue_token(const char *pos, const char *end);
+    const char *find_token_end(const char *pos, const char *end);
+    void finish_token(std::string_view text);
+
+    void start_container(ObjectType type);
+    void end_container(ObjectType type);
+    void value_done();
+
+    Writer &writer();
+
+    /// The key of the next value, if it is inside of a map
+    std::string_view key() const;
+
+    State m_state = State::Value;
+    std::stack<ObjectType, std::vector<ObjectType>> m_containers;
+
+    Token m_token = Token::None;
+    bool m_escaped = false;
+    uint32_t m_quotes = 0;
+
+    /// Text of a token that started in a previous chunk
+    std::string m_token_text;
+    std::string m_key;
+
+    std::unique_ptr<StringDecoder> m_strings;
+    std::optional<Writer> m_writer;
+    std::deque<Document> m_documents;
+};
+
+} // namespace json
@@ -8,6 +8,10 @@
 #include "bitstream.h"
 #include "defines.h"
 
+#include <list>
+#include <span>
+#include <unordered_map>
+
 namespace json
 {
 
@@ -22,6 +26,34 @@ public:
     Writer();
     ~Writer();
 
+    /**
+     * Start writing a new document to result
+     *
+     * Any unfinished state is discarded. Memory used for tracking nested
+     * maps and arrays is kept.
+     */
+    void reset(bitstream &result);
+
+    /**
+     * Write maps with at least min_size entries as ObjectType::SortedMap
+     *
+     * Keys of those maps can be found with a binary search. The key table
+     * takes four bytes per entry and is built when the map ends. Zero, the
+     * default, writes all maps unsorted. Sorted maps cannot be changed with
+     * Document::insert().
+     */
+    void set_sorted_map_threshold(uint32_t min_size) { m_sorted_map_threshold = min_size; }
+
+    /**
+     * Write maps as ObjectType::DictionaryMap, which refer to keys by id
+     *
+     * Every distinct key is stored only once, in an ObjectType::KeyDictionary
+     * that is put in front of the document when it is finished. Up to 65535
+     * distinct keys are supported. Maps are never sorted in this mode. This
+     * has to be set before the document is started.
+     */
+    void set_key_dictionary(bool enabled) { m_use_key_dictionary = enabled; }
+
     void start_map() { start_map(EMPTY_KEY); }
     void start_array() { start_array(EMPTY_KEY); }
 
@@ -29,21 +61,43 @@ public:
     void write_binary(const bitstream &value) { write_binary(EMPTY_KEY, value); }
     void write_boolean(const bool value) { write_boolean(EMPTY_KEY, value); }
     void write_datetime(const tm &value) { write_datetime(EMPTY_KEY, value); }
+    void write_timestamp(const timestamp_t &value) { write_timestamp(EMPTY_KEY, value); }
     void write_integer(const integer_t &value) { write_integer(EMPTY_KEY, value); }
-    void write_string(const std::string &value) { write_string(EMPTY_KEY, value); }
+    void write_string(std::string_view value) { write_string(EMPTY_KEY, value); }
     void write_float(const float_t &value) { write_float(EMPTY_KEY, value); }
+    void write_integers(std::span<const integer_t> values) { write_integers(EMPTY_KEY, values); }
+    void write_floats(std::span<const float_t> values) { write_floats(EMPTY_KEY, values); }
 
 
-    void start_map(const std::string &key);
+    void start_map(std::string_view key);
     void end_map();
 
-    void start_array(const std::string &key);
+    /**
+     * End the current map and write it as ObjectType::SortedMap, no matter
+     * how many entries it has
+     *
+     * \note Ends the map like end_map() does if a key dictionary is used
+     */
+    void end_sorted_map();
+
+    void start_array(std::string_view key);
     void end_array();
 
+    /**
+     * Remove the value that was written last, including its key
+     *
+     * Used to take back a map or array after it turned out to be unwanted.
+     * Keys that were added to a key dictionary are kept.
+     *
+     * \param start
+     *      The position of the result before the value was written
+     */
+    void discard_value(uint32_t start);
+
     /// Write data that is already binary formatted.
-    void write_raw_data(const std::string &key, const uint8_t *data, uint32_t size);
+    void write_raw_data(std::string_view key, const uint8_t *data, uint32_t size);
 
-    void write_document(const std::string &key, const json::Document &other)
+    void write_document(std::string_view key, const json::Document &other)
     {
         if(!other.valid())
         {
@@ -53,26 +107,68 @@ public:
         write_raw_data(key, other.data().data(), other.data().size());
     }
 
-    void write_null(const std::string &key);
-    void write_binary(const std::string &key, const bitstream &value);
-    void write_boolean(const std::string &key, const bool value);
-    void write_datetime(const std::string &key, const tm &value);
-    void write_integer(const std::string &key, const integer_t &value);
-    void write_string(const std::string &key, const std::string &value);
-    void write_float(const std::string &key, const float_t &value);
+    void write_null(std::string_view key);
+    void write_binary(std::string_view key, const bitstream &value);
+    void write_boolean(std::string_view key, const bool value);
+    /**
+     * Write a datetime given in the old format
+     *
+     * The fields hold calendar values as written, i.e. the year is not
+     * relative to 1900 and months start at 1. It is stored as a timestamp.
+     */
+    void write_datetime(std::string_view key, const tm &value);
+    void write_timestamp(std::string_view key, const timestamp_t &value);
+    void write_integer(std::string_view key, const integer_t &value);
+    void write_string(std::string_view key, std::string_view value);
+    void write_float(std::string_view key, const float_t &value);
+
+    /**
+     * Write an array of integers as ObjectType::TypedArray
+     *
+     * The values are stored contiguously and aligned to eight bytes, so that
+     * Document::as_integer_span() can return them without copying. They are
+     * read like any other array otherwise.
+     */
+    void write_integers(std::string_view key, std::span<const integer_t> values);
+
+    /**
+     * Write an array of floats as ObjectType::TypedArray
+     *
+     * \see write_integers
+     */
+    void write_floats(std::string_view key, std::span<const float_t> values);
 
 #ifdef USE_GEO
-    void write_vector2(const std::string &key, const geo::vector2d &vec);
+    void write_vector2(std::string_view key, const geo::vector2d &vec);
 #endif
 
     json::Document make_document();
 
 private:
-    void handle_key(const std::string &key);
+    void handle_key(std::string_view key);
     void check_end();
+    void finish_map(bool sorted);
+
+    /**
+     * Turn the map that was just written into a SortedMap
+     */
+    void sort_map(uint32_t start_pos, uint32_t size);
+
+    void write_typed_array(std::string_view key, ObjectType element_type,
+                           const uint8_t *values, size_t size);
+
+    /**
+     * \throws json_error if the dictionary is full
+     */
+    key_id_t key_id(std::string_view key);
+
+    /**
+     * Put the key dictionary in front of the document that was just finished
+     */
+    void write_key_dictionary();
 
     bitstream *m_result_ptr;
-    bitstream &m_result;
+    bitstream *m_result;
 
     enum mode_t
     {
@@ -81,9 +177,20 @@ private:
         DONE
     };
 
-    std::stack<mode_t> m_mode;
-    std::stack<uint32_t> m_starts;
-    std::stack<uint32_t> m_sizes;
+    // Vectors keep their capacity, so nesting does not allocate repeatedly
+    std::stack<mode_t, std::vector<mode_t>> m_mode;
+    std::stack<uint32_t, std::vector<uint32_t>> m_starts;
+    std::stack<uint32_t, std::vector<uint32_t>> m_sizes;
+
+    uint32_t m_sorted_map_threshold = 0;
+    std::vector<uint32_t> m_key_offsets;
+
+    bool m_use_key_dictionary = false;
+    uint32_t m_document_start = 0;
+
+    // Lists do not move their elements, so the views of the map stay valid
+    std::list<std::string> m_keys;
+    std::unordered_map<std::string_view, key_id_t> m_key_ids;
 };
 
 } // namespace json
@@ -27,7 +27,47 @@ enum class ObjectType : uint8_t
     False,
     Binary,
     Vector2,
-    Null
+    Null,
+    Timestamp,
+
+    /**
+     * A map with a table of its entries sorted by key
+     *
+     * Laid out like a map, except that the entry count is followed by one
+     * uint32_t per entry: the offset of the entry relative to the first one.
+     * These offsets are ordered by key, so that keys can be found with a
+     * binary search. The entries themselves keep their original order.
+     */
+    SortedMap,
+
+    /**
+     * A table of keys, followed by the value that refers to them
+     *
+     * Holds the byte size of everything that follows it, the number of keys,
+     * one uint32_t offset per key relative to the first one and the keys
+     * themselves, encoded like strings without a type. Zero bytes pad the
+     * dictionary to a multiple of eight bytes. Maps in the value after it
+     * are usually written as DictionaryMap.
+     */
+    KeyDictionary,
+
+    /**
+     * A map whose keys are stored in the enclosing KeyDictionary
+     *
+     * Laid out like a map, except that every entry starts with the key_id_t
+     * of its key instead of the key itself.
+     */
+    DictionaryMap,
+
+    /**
+     * An array whose elements all have the same numeric type
+     *
+     * Holds the byte size, the number of elements, the ObjectType of the
+     * elements (Integer or Float) and a uint8_t count of padding bytes. The
+     * padding makes the values start at a multiple of eight bytes from the
+     * start of the document. The values follow without a type each.
+     */
+    TypedArray
 };
 
 enum class DocumentMode
@@ -57,4 +97,26 @@ inline bool is_keyword(const std::string &str) { return str == "+"; }
 typedef int64_t integer_t;
 typedef double float_t;
 
+/// Position of a key in a key dictionary
+typedef uint16_t key_id_t;
+
+/**
+ * A point in time with microsecond precision
+ *
+ * This is what datetimes are stored as. Old documents might still hold
+ * ObjectType::Datetime values, which contain a whole struct tm instead.
+ * Document::convert_datetimes() replaces those.
+ */
+struct timestamp_t
+{
+    /// Microseconds since the Unix epoch (UTC)
+    int64_t micros = 0;
+
+    /// Offset of the time zone the value was written in, in minutes
+    int16_t utc_offset = 0;
+};
+
+/// Size of an encoded timestamp, excluding its type
+constexpr uint32_t TIMESTAMP_SIZE = sizeof(int64_t) + sizeof(int16_t);
+
 } // namespace json
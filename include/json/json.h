@@ -1,6 +1,11 @@
 #pragma once
 
+#include "json/BulkParser.h"
 #include "json/Document.h"
+#include "json/DocumentParser.h"
 #include "json/Iterator.h"
+#include "json/Path.h"
+#include "json/Reductions.h"
+#include "json/StreamParser.h"
 #include "json/Writer.h"
 #include "json/json_error.h"
@@ -3,6 +3,8 @@
 #include <stdexcept>
 #include <string>
 
+#include "json/ParseError.h"
+
 class json_error : public std::exception
 {
 public:
@@ -13,3 +15,25 @@ public:
 private:
     const std::string m_msg;
 };
+
+/**
+ * Thrown if JSON text is malformed
+ */
+class json_parse_error : public json_error
+{
+public:
+    json_parse_error(json::ParseErrorCode code, const std::string &msg,
+                     size_t offset = std::string::npos)
+        : json_error(msg), m_code(code), m_offset(offset)
+    {
+    }
+
+    json::ParseErrorCode code() const { return m_code; }
+
+    /// Byte offset of the error, or std::string::npos if it is not known
+    size_t offset() const { return m_offset; }
+
+private:
+    json::ParseErrorCode m_code;
+    size_t m_offset;
+};
@@ -0,0 +1,366 @@
+#include "json/BulkParser.h"
+#include "json/DocumentParser.h"
+#include "IndexedParser.h"
+#include "RecordFilter.h"
+#include "StructuralIndex.h"
+#include "json.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <iterator>
+
+#ifndef IS_ENCLAVE
+#include <thread>
+#endif
+
+namespace json {
+
+namespace {
+
+/// Smaller inputs are not worth spawning another thread for
+constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+inline bool is_whitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/**
+ * Call func for every non-empty line of the chunk
+ */
+template <typename Func>
+void for_each_record(std::string_view chunk, const Func &func) {
+    const char *pos = chunk.data();
+    const char *end = pos + chunk.size();
+
+    while (pos < end) {
+        const auto *newline =
+            static_cast<const char *>(memchr(pos, '\n', end - pos));
+        const char *line_end = newline != nullptr ? newline : end;
+
+        while (pos < line_end && is_whitespace(*pos)) {
+            ++pos;
+        }
+
+        if (pos != line_end) {
+            func(std::string_view(pos, line_end - pos));
+        }
+
+        pos = line_end + 1;
+    }
+}
+
+/**
+ * Call func(i) for every i in [0, count) on its own thread
+ *
+ * Waits for all threads to finish and rethrows the exception of the first
+ * call that failed, if any.
+ */
+template <typename Func> void run_parallel(size_t count, const Func &func) {
+#ifdef IS_ENCLAVE
+    // Enclaves cannot spawn threads
+    for (size_t i = 0; i < count; ++i) {
+        func(i);
+    }
+#else
+    if (count == 0) {
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(count);
+
+    auto run = [&](size_t i) {
+        try {
+            func(i);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(count - 1);
+
+    for (size_t i = 1; i < count; ++i) {
+        threads.emplace_back(run, i);
+    }
+
+    run(0);
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (auto &error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+#endif
+}
+
+/**
+ * Find the comma or bracket after every element of the top-level array
+ *
+ * \returns an empty list if the input is not an array or an empty one
+ */
+std::vector<size_t> find_separators(std::string_view input,
+                                    const StructuralIndex &index) {
+    std::vector<size_t> separators;
+
+    if (index.size() < 2 || input[index[0]] != '[' || input[index[1]] == ']') {
+        return separators;
+    }
+
+    size_t depth = 0;
+
+    for (size_t i = 0; i < index.size(); ++i) {
+        switch (input[index[i]]) {
+        case '[':
+        case '{':
+            ++depth;
+            break;
+        case ']':
+        case '}':
+            --depth;
+
+            if (depth == 0) {
+                separators.push_back(i);
+                return separators;
+            }
+            break;
+        case ',':
+            if (depth == 1) {
+                separators.push_back(i);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    throw json_error("Array not terminated!");
+}
+
+/**
+ * Parse the input as a whole, like Document::parse does
+ */
+Document parse_document(std::string_view input, const ParseOptions &options) {
+    Document doc;
+    DocumentParser(options).parse(input, doc);
+    return doc;
+}
+
+} // namespace
+
+BulkParser::BulkParser(size_t num_threads, const ParseOptions &options)
+    : m_num_threads(num_threads), m_options(options) {
+#ifdef IS_ENCLAVE
+    m_num_threads = 1;
+#else
+    if (m_num_threads == 0) {
+        m_num_threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+#endif
+}
+
+size_t BulkParser::num_chunks(size_t input_size) const {
+    return std::max<size_t>(
+        1, std::min(m_num_threads, input_size / MIN_CHUNK_SIZE));
+}
+
+std::vector<std::string_view>
+BulkParser::split(std::string_view input) const {
+    const size_t count = num_chunks(input.size());
+
+    std::vector<std::string_view> chunks;
+    chunks.reserve(count);
+
+    size_t start = 0;
+
+    for (size_t i = 1; i < count; ++i) {
+        const size_t target = std::max(start, input.size() * i / count);
+        const size_t newline = input.find('\n', target);
+
+        if (newline == std::string_view::npos) {
+            break;
+        }
+
+        chunks.push_back(input.substr(start, newline + 1 - start));
+        start = newline + 1;
+    }
+
+    if (start < input.size()) {
+        chunks.push_back(input.substr(start));
+    }
+
+    return chunks;
+}
+
+std::vector<Document> BulkParser::parse(std::string_view input) const {
+    return parse(input, Document());
+}
+
+void BulkParser::parse(std::string_view input, bitstream &output) const {
+    parse(input, Document(), output);
+}
+
+std::vector<Document> BulkParser::parse(std::string_view input,
+                                        const Document &predicates) const {
+    const auto chunks = split(input);
+    const RecordFilter filter(predicates);
+    std::vector<std::vector<Document>> results(chunks.size());
+
+    run_parallel(chunks.size(), [&](size_t i) {
+        StructuralIndex index;
+
+        for_each_record(chunks[i], [&](std::string_view record) {
+            index.build(record.data(), record.size(), IndexKernel::Best,
+                        m_options.validate_utf8);
+
+            if (!filter.matches(record, index)) {
+                return;
+            }
+
+            Document doc;
+
+            IndexedParser parser(record, doc.mutable_data(), index);
+            parser.do_parse();
+            parser.finish_input();
+
+            doc.mutable_data().move_to(0);
+            results[i].push_back(std::move(doc));
+        });
+    });
+
+    size_t total = 0;
+
+    for (auto &result : results) {
+        total += result.size();
+    }
+
+    std::vector<Document> documents;
+    documents.reserve(total);
+
+    for (auto &result : results) {
+        std::move(result.begin(), result.end(), std::back_inserter(documents));
+    }
+
+    return documents;
+}
+
+void BulkParser::parse(std::string_view input, const Document &predicates,
+                       bitstream &output) const {
+    const auto chunks = split(input);
+    const RecordFilter filter(predicates);
+
+    // The first chunk is written to the output directly
+    std::vector<bitstream> results(chunks.size());
+
+    run_parallel(chunks.size(), [&](size_t i) {
+        auto &out = i == 0 ? output : results[i];
+        StructuralIndex index;
+
+        for_each_record(chunks[i], [&](std::string_view record) {
+            index.build(record.data(), record.size(), IndexKernel::Best,
+                        m_options.validate_utf8);
+
+            if (!filter.matches(record, index)) {
+                return;
+            }
+
+            const uint32_t size_pos = out.pos();
+            out << static_cast<uint32_t>(0);
+
+            IndexedParser parser(record, out, index);
+            parser.do_parse();
+            parser.finish_input();
+
+            const uint32_t end_pos = out.pos();
+            out.move_to(size_pos);
+            out << static_cast<uint32_t>(end_pos - size_pos - sizeof(uint32_t));
+            out.move_to(end_pos);
+        });
+    });
+
+    for (size_t i = 1; i < results.size(); ++i) {
+        output.write_raw_data(results[i].data(), results[i].size());
+    }
+}
+
+Document BulkParser::parse_array(std::string_view input) const {
+    const size_t count = num_chunks(input.size());
+
+    if (count == 1) {
+        return parse_document(input, m_options);
+    }
+
+    StructuralIndex index;
+    index.build(input.data(), input.size(), IndexKernel::Best,
+                m_options.validate_utf8);
+
+    const auto separators = find_separators(input, index);
+
+    if (separators.size() < count) {
+        return parse_document(input, m_options);
+    }
+
+    // Split into ranges of elements with a similar number of structurals
+    std::vector<size_t> first_elements = {0};
+
+    for (size_t i = 1; i < separators.size(); ++i) {
+        const size_t target = separators.back() * first_elements.size() / count;
+
+        if (separators[i - 1] >= target) {
+            first_elements.push_back(i);
+
+            if (first_elements.size() == count) {
+                break;
+            }
+        }
+    }
+
+    std::vector<bitstream> results(first_elements.size());
+
+    run_parallel(first_elements.size(), [&](size_t i) {
+        const size_t first = first_elements[i];
+        const size_t last = i + 1 < first_elements.size()
+                                ? first_elements[i + 1] - 1
+                                : separators.size() - 1;
+
+        const size_t begin = first == 0 ? 1 : separators[first - 1] + 1;
+
+        IndexedParser parser(input, results[i], index);
+        parser.parse_elements(begin, separators[last]);
+    });
+
+    // Every partial array starts with a type, byte size and element count
+    constexpr size_t HEADER_SIZE = sizeof(ObjectType) + 2 * sizeof(uint32_t);
+
+    uint32_t byte_size = sizeof(uint32_t);
+    uint32_t size = 0;
+
+    for (auto &result : results) {
+        uint32_t part_size;
+        memcpy(&part_size, result.data() + HEADER_SIZE - sizeof(uint32_t),
+               sizeof(part_size));
+
+        byte_size += result.size() - HEADER_SIZE;
+        size += part_size;
+    }
+
+    bitstream output;
+    output << ObjectType::Array << byte_size << size;
+
+    for (auto &result : results) {
+        output.write_raw_data(result.data() + HEADER_SIZE,
+                              result.size() - HEADER_SIZE);
+    }
+
+    uint8_t *data = nullptr;
+    uint32_t length = 0;
+    output.detach(data, length);
+
+    return Document(data, length, DocumentMode::ReadWrite);
+}
+
+} // namespace json
@@ -0,0 +1,410 @@
+#include "CompactFormat.h"
+#include "DocumentTraversal.h"
+#include "TypedArray.h"
+#include "json.h"
+#include "json/json_error.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace json {
+
+namespace {
+
+/// A varint of eight bytes holds 56 bits
+constexpr uint64_t MAX_SHORT_VARINT = (uint64_t(1) << 56) - 1;
+
+inline uint64_t zigzag_encode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^
+           static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value) {
+    return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+} // namespace
+
+void CompactEncoder::encode(const bitstream &content) {
+    if (content.empty()) {
+        return;
+    }
+
+    bitstream view;
+    view.assign(content.data(), content.size(), true);
+
+    encode_value(view, KeyDictionary());
+}
+
+void CompactEncoder::encode_value(bitstream &view, const KeyDictionary &keys) {
+    ObjectType type;
+    view >> type;
+
+    switch (type) {
+    case ObjectType::Null:
+        m_result << compact::NULL_VALUE;
+        break;
+    case ObjectType::False:
+        m_result << compact::FALSE_VALUE;
+        break;
+    case ObjectType::True:
+        m_result << compact::TRUE_VALUE;
+        break;
+    case ObjectType::Integer: {
+        integer_t value;
+        view >> value;
+
+        const uint64_t zigzag = zigzag_encode(value);
+
+        if (value >= 0 && value < compact::SMALL_INTEGER_LIMIT) {
+            m_result << static_cast<uint8_t>(compact::SMALL_INTEGER + value);
+        } else if (zigzag <= MAX_SHORT_VARINT) {
+            m_result << compact::VARINT;
+            write_varint(zigzag);
+        } else {
+            m_result << compact::INTEGER << value;
+        }
+        break;
+    }
+    case ObjectType::Float: {
+        json::float_t value;
+        view >> value;
+
+        // Converting doubles outside of the range of float is undefined
+        if (std::fabs(value) <= FLT_MAX &&
+            static_cast<double>(static_cast<float>(value)) == value) {
+            m_result << compact::FLOAT32 << static_cast<float>(value);
+        } else {
+            m_result << compact::FLOAT << value;
+        }
+        break;
+    }
+    case ObjectType::String: {
+        uint32_t length;
+        view >> length;
+
+        write_length(compact::SHORT_STRING, compact::SHORT_STRING_LIMIT,
+                     compact::STRING, length);
+        m_result.write_raw_data(view.current(), length);
+        view.move_by(length);
+        break;
+    }
+    case ObjectType::Binary: {
+        uint32_t length;
+        view >> length;
+
+        m_result << compact::BINARY;
+        write_varint(length);
+        m_result.write_raw_data(view.current(), length);
+        view.move_by(length);
+        break;
+    }
+    case ObjectType::Timestamp: {
+        timestamp_t value;
+        view >> value.micros >> value.utc_offset;
+
+        m_result << compact::TIMESTAMP;
+        write_varint(zigzag_encode(value.micros));
+        write_varint(zigzag_encode(value.utc_offset));
+        break;
+    }
+    case ObjectType::Datetime:
+        m_result << compact::DATETIME;
+        m_result.write_raw_data(view.current(), sizeof(tm));
+        view.move_by(sizeof(tm));
+        break;
+#ifdef USE_GEO
+    case ObjectType::Vector2:
+        m_result << compact::VECTOR2;
+        m_result.write_raw_data(view.current(), sizeof(geo::vector2d));
+        view.move_by(sizeof(geo::vector2d));
+        break;
+#endif
+    case ObjectType::TypedArray: {
+        ObjectType element_type;
+        uint32_t size;
+        read_typed_array(view, element_type, size);
+
+        if (element_type == ObjectType::Integer) {
+            m_result << compact::INTEGER_ARRAY;
+        } else {
+            m_result << compact::FLOAT_ARRAY;
+        }
+
+        write_varint(size);
+
+        const uint32_t data_size = size * TYPED_ARRAY_ELEMENT_SIZE;
+        m_result.write_raw_data(view.current(), data_size);
+        view.move_by(data_size);
+        break;
+    }
+    case ObjectType::KeyDictionary: {
+        KeyDictionary inner;
+        inner.load(view);
+        encode_value(view, inner);
+        break;
+    }
+    case ObjectType::Map:
+    case ObjectType::SortedMap:
+    case ObjectType::DictionaryMap: {
+        uint32_t byte_size, size;
+        view >> byte_size >> size;
+        DocumentTraversal::skip_key_table(type, size, view);
+
+        write_length(compact::SMALL_MAP, compact::SMALL_MAP_LIMIT,
+                     compact::MAP, size);
+
+        for (uint32_t i = 0; i < size; ++i) {
+            const auto key = keys.read_key(type, view);
+
+            write_varint(key.size());
+            m_result.write_raw_data(
+                reinterpret_cast<const uint8_t *>(key.data()), key.size());
+
+            encode_value(view, keys);
+        }
+        break;
+    }
+    case ObjectType::Array: {
+        uint32_t byte_size, size;
+        view >> byte_size >> size;
+
+        write_length(compact::SMALL_ARRAY, compact::SMALL_ARRAY_LIMIT,
+                     compact::ARRAY, size);
+
+        for (uint32_t i = 0; i < size; ++i) {
+            encode_value(view, keys);
+        }
+        break;
+    }
+    default:
+        throw json_error("Cannot encode: Unknown object type");
+    }
+}
+
+void CompactEncoder::write_length(uint8_t small_tag, uint8_t small_limit,
+                                  uint8_t tag, uint32_t length) {
+    if (length < small_limit) {
+        m_result << static_cast<uint8_t>(small_tag + length);
+    } else {
+        m_result << tag;
+        write_varint(length);
+    }
+}
+
+void CompactEncoder::write_varint(uint64_t value) {
+    uint8_t buffer[10];
+    uint32_t length = 0;
+
+    while (value >= 0x80) {
+        buffer[length++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+
+    buffer[length++] = static_cast<uint8_t>(value);
+    m_result.write_raw_data(buffer, length);
+}
+
+void CompactDecoder::decode() {
+    m_document_start = m_result.pos();
+
+    // Every byte of input produces at least one byte of output
+    reserve(m_result, m_end - m_pos);
+
+    decode_value();
+
+    if (m_pos != m_end) {
+        throw json_error("Compact document has trailing data");
+    }
+}
+
+void CompactDecoder::decode_value() {
+    const uint8_t tag = read_byte();
+
+    if (tag < compact::SHORT_STRING) {
+        m_result << ObjectType::Integer
+                 << static_cast<integer_t>(tag - compact::SMALL_INTEGER);
+        return;
+    } else if (tag < compact::SMALL_MAP) {
+        decode_string(tag - compact::SHORT_STRING);
+        return;
+    } else if (tag < compact::SMALL_ARRAY) {
+        decode_map(tag - compact::SMALL_MAP);
+        return;
+    } else if (tag < compact::NULL_VALUE) {
+        decode_array(tag - compact::SMALL_ARRAY);
+        return;
+    }
+
+    switch (tag) {
+    case compact::NULL_VALUE:
+        m_result << ObjectType::Null;
+        break;
+    case compact::FALSE_VALUE:
+        m_result << ObjectType::False;
+        break;
+    case compact::TRUE_VALUE:
+        m_result << ObjectType::True;
+        break;
+    case compact::VARINT:
+        m_result << ObjectType::Integer
+                 << static_cast<integer_t>(zigzag_decode(read_varint()));
+        break;
+    case compact::INTEGER: {
+        integer_t value;
+        memcpy(&value, read_bytes(sizeof(value)), sizeof(value));
+        m_result << ObjectType::Integer << value;
+        break;
+    }
+    case compact::FLOAT: {
+        json::float_t value;
+        memcpy(&value, read_bytes(sizeof(value)), sizeof(value));
+        m_result << ObjectType::Float << value;
+        break;
+    }
+    case compact::FLOAT32: {
+        float value;
+        memcpy(&value, read_bytes(sizeof(value)), sizeof(value));
+        m_result << ObjectType::Float << static_cast<json::float_t>(value);
+        break;
+    }
+    case compact::STRING:
+        decode_string(read_varint());
+        break;
+    case compact::MAP:
+        decode_map(read_varint());
+        break;
+    case compact::ARRAY:
+        decode_array(read_varint());
+        break;
+    case compact::BINARY:
+        m_result << ObjectType::Binary;
+        copy_length_prefixed(read_varint());
+        break;
+    case compact::TIMESTAMP: {
+        const int64_t micros = zigzag_decode(read_varint());
+        const int64_t utc_offset = zigzag_decode(read_varint());
+
+        if (utc_offset < INT16_MIN || utc_offset > INT16_MAX) {
+            throw json_error("Compact document has an invalid UTC offset");
+        }
+
+        m_result << ObjectType::Timestamp << micros
+                 << static_cast<int16_t>(utc_offset);
+        break;
+    }
+    case compact::DATETIME:
+        m_result << ObjectType::Datetime;
+        m_result.write_raw_data(read_bytes(sizeof(tm)), sizeof(tm));
+        break;
+#ifdef USE_GEO
+    case compact::VECTOR2:
+        m_result << ObjectType::Vector2;
+        m_result.write_raw_data(read_bytes(sizeof(geo::vector2d)),
+                                sizeof(geo::vector2d));
+        break;
+#endif
+    case compact::INTEGER_ARRAY:
+        decode_typed_array(ObjectType::Integer);
+        break;
+    case compact::FLOAT_ARRAY:
+        decode_typed_array(ObjectType::Float);
+        break;
+    default:
+        throw json_error("Compact document has an unknown type");
+    }
+}
+
+void CompactDecoder::decode_string(uint64_t length) {
+    m_result << ObjectType::String;
+    copy_length_prefixed(length);
+}
+
+void CompactDecoder::decode_map(uint64_t size) {
+    if (size > UINT32_MAX) {
+        throw json_error("Compact document has too many entries");
+    }
+
+    m_result << ObjectType::Map;
+
+    const uint32_t start = m_result.pos();
+    m_result << static_cast<uint32_t>(0) << static_cast<uint32_t>(size);
+
+    for (uint64_t i = 0; i < size; ++i) {
+        copy_length_prefixed(read_varint());
+        decode_value();
+    }
+
+    const uint32_t end = m_result.pos();
+    m_result.move_to(start);
+    m_result << static_cast<uint32_t>(end - start - sizeof(uint32_t));
+    m_result.move_to(end);
+}
+
+void CompactDecoder::decode_array(uint64_t size) {
+    if (size > UINT32_MAX) {
+        throw json_error("Compact document has too many entries");
+    }
+
+    m_result << ObjectType::Array;
+
+    const uint32_t start = m_result.pos();
+    m_result << static_cast<uint32_t>(0) << static_cast<uint32_t>(size);
+
+    for (uint64_t i = 0; i < size; ++i) {
+        decode_value();
+    }
+
+    const uint32_t end = m_result.pos();
+    m_result.move_to(start);
+    m_result << static_cast<uint32_t>(end - start - sizeof(uint32_t));
+    m_result.move_to(end);
+}
+
+void CompactDecoder::decode_typed_array(ObjectType element_type) {
+    const uint64_t size = read_varint();
+
+    if (size > UINT32_MAX / TYPED_ARRAY_ELEMENT_SIZE) {
+        throw json_error("Compact document has too many entries");
+    }
+
+    const uint8_t *values = read_bytes(size * TYPED_ARRAY_ELEMENT_SIZE);
+    write_typed_array(m_result, m_document_start, element_type, values, size);
+}
+
+uint8_t CompactDecoder::read_byte() { return *read_bytes(1); }
+
+uint64_t CompactDecoder::read_varint() {
+    uint64_t value = 0;
+
+    for (uint32_t shift = 0; shift < 64; shift += 7) {
+        const uint8_t byte = read_byte();
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+
+    throw json_error("Compact document has an invalid varint");
+}
+
+const uint8_t *CompactDecoder::read_bytes(uint64_t length) {
+    if (length > static_cast<uint64_t>(m_end - m_pos)) {
+        throw json_error("Compact document is truncated");
+    }
+
+    const uint8_t *data = m_pos;
+    m_pos += length;
+    return data;
+}
+
+void CompactDecoder::copy_length_prefixed(uint64_t length) {
+    const uint8_t *data = read_bytes(length);
+
+    m_result << static_cast<uint32_t>(length);
+    m_result.write_raw_data(data, length);
+}
+
+} // namespace json
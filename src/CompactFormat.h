@@ -0,0 +1,142 @@
+#pragma once
+
+#include <bitstream.h>
+
+#include "KeyDictionary.h"
+
+namespace json {
+
+/**
+ * Type bytes of the compact wire format
+ *
+ * Every value starts with a type byte. Small non-negative integers as well
+ * as the lengths of short strings and the sizes of small maps and arrays are
+ * stored in the type byte itself. All other lengths and sizes follow as
+ * LEB128 varints. Integers are zigzag varints, unless they need more than
+ * eight bytes that way. Map entries are a varint key length, the key and the
+ * value. Maps and arrays do not store their byte size, and typed arrays drop
+ * their padding.
+ */
+namespace compact {
+
+/// 0x00 to 0x3f: integers from 0 to 63
+constexpr uint8_t SMALL_INTEGER = 0x00;
+constexpr uint8_t SMALL_INTEGER_LIMIT = 0x40;
+
+/// 0x40 to 0x5f: strings of up to 31 bytes
+constexpr uint8_t SHORT_STRING = 0x40;
+constexpr uint8_t SHORT_STRING_LIMIT = 0x20;
+
+/// 0x60 to 0x6f: maps with up to 15 entries
+constexpr uint8_t SMALL_MAP = 0x60;
+constexpr uint8_t SMALL_MAP_LIMIT = 0x10;
+
+/// 0x70 to 0x7f: arrays with up to 15 elements
+constexpr uint8_t SMALL_ARRAY = 0x70;
+constexpr uint8_t SMALL_ARRAY_LIMIT = 0x10;
+
+constexpr uint8_t NULL_VALUE = 0x80;
+constexpr uint8_t FALSE_VALUE = 0x81;
+constexpr uint8_t TRUE_VALUE = 0x82;
+
+/// A zigzag varint
+constexpr uint8_t VARINT = 0x83;
+
+/// A fixed eight byte integer
+constexpr uint8_t INTEGER = 0x84;
+
+constexpr uint8_t FLOAT = 0x85;
+
+/// A double that is exactly representable as a float, stored as one
+constexpr uint8_t FLOAT32 = 0x86;
+
+constexpr uint8_t STRING = 0x87;
+constexpr uint8_t MAP = 0x88;
+constexpr uint8_t ARRAY = 0x89;
+constexpr uint8_t BINARY = 0x8a;
+
+/// Zigzag varints of the microseconds and the UTC offset
+constexpr uint8_t TIMESTAMP = 0x8b;
+
+/// A datetime in the old encoding, copied verbatim
+constexpr uint8_t DATETIME = 0x8c;
+
+constexpr uint8_t VECTOR2 = 0x8d;
+
+/// Typed arrays: a varint count followed by the values, without padding
+constexpr uint8_t INTEGER_ARRAY = 0x8e;
+constexpr uint8_t FLOAT_ARRAY = 0x8f;
+
+} // namespace compact
+
+/**
+ * Converts documents to the compact wire format
+ *
+ * Sorted maps are written as regular maps, and keys that are stored in a key
+ * dictionary are written inline.
+ */
+class CompactEncoder {
+  public:
+    explicit CompactEncoder(bitstream &result) : m_result(result) {}
+
+    void encode(const bitstream &content);
+
+  private:
+    void encode_value(bitstream &view, const KeyDictionary &keys);
+
+    /**
+     * Write a type byte, packing the length into it if it is small enough
+     */
+    void write_length(uint8_t small_tag, uint8_t small_limit, uint8_t tag,
+                      uint32_t length);
+
+    void write_varint(uint64_t value);
+
+    bitstream &m_result;
+};
+
+/**
+ * Converts the compact wire format back into a document
+ *
+ * The input is fully bounds-checked, so that it can come from an untrusted
+ * source.
+ */
+class CompactDecoder {
+  public:
+    CompactDecoder(const uint8_t *data, uint32_t length, bitstream &result)
+        : m_pos(data), m_end(data + length), m_result(result) {}
+
+    /**
+     * \throws json_error if the input is not a single valid value
+     */
+    void decode();
+
+  private:
+    void decode_value();
+    void decode_string(uint64_t length);
+    void decode_map(uint64_t size);
+    void decode_array(uint64_t size);
+    void decode_typed_array(ObjectType element_type);
+
+    uint8_t read_byte();
+    uint64_t read_varint();
+
+    /**
+     * \returns a pointer to the next length bytes of the input
+     */
+    const uint8_t *read_bytes(uint64_t length);
+
+    /**
+     * Copy a length prefix and as many bytes, like strings are encoded
+     */
+    void copy_length_prefixed(uint64_t length);
+
+    const uint8_t *m_pos;
+    const uint8_t *const m_end;
+    bitstream &m_result;
+
+    /// Typed arrays are aligned relative to this
+    uint32_t m_document_start = 0;
+};
+
+} // namespace json
@@ -0,0 +1,292 @@
+#include "Datetime.h"
+#include "json/json_error.h"
+
+#include <cstring>
+
+namespace json {
+
+namespace {
+
+constexpr int64_t MICROS_PER_SECOND = 1000000;
+constexpr int64_t SECONDS_PER_DAY = 24 * 60 * 60;
+constexpr int64_t MICROS_PER_DAY = SECONDS_PER_DAY * MICROS_PER_SECOND;
+
+[[noreturn]] void invalid_datetime() {
+    throw json_parse_error(ParseErrorCode::InvalidDatetime,
+                           "Failed to parse datetime");
+}
+
+/**
+ * Days since 1970-01-01 in the proleptic Gregorian calendar
+ *
+ * See http://howardhinnant.github.io/date_algorithms.html
+ */
+int64_t days_from_civil(int64_t year, int64_t month, int64_t day) {
+    year -= month <= 2 ? 1 : 0;
+
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t year_of_era = year - era * 400;
+    const int64_t day_of_year =
+        (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t day_of_era = year_of_era * 365 + year_of_era / 4 -
+                               year_of_era / 100 + day_of_year;
+
+    return era * 146097 + day_of_era - 719468;
+}
+
+void civil_from_days(int64_t days, int64_t &year, int64_t &month,
+                     int64_t &day) {
+    days += 719468;
+
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t day_of_era = days - era * 146097;
+    const int64_t year_of_era =
+        (day_of_era - day_of_era / 1460 + day_of_era / 36524 -
+         day_of_era / 146096) /
+        365;
+    const int64_t day_of_year =
+        day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const int64_t mp = (5 * day_of_year + 2) / 153;
+
+    day = day_of_year - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+int64_t days_in_month(int64_t year, int64_t month) {
+    static constexpr int64_t DAYS[] = {31, 28, 31, 30, 31, 30,
+                                       31, 31, 30, 31, 30, 31};
+
+    if (month == 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) {
+        return 29;
+    }
+
+    return DAYS[month - 1];
+}
+
+/**
+ * Read at least min_count and at most max_count digits
+ */
+int64_t read_digits(const char *&pos, const char *end, size_t min_count,
+                    size_t max_count) {
+    int64_t result = 0;
+    size_t count = 0;
+
+    for (; count < max_count && pos != end; ++count, ++pos) {
+        const auto digit = static_cast<unsigned char>(*pos - '0');
+
+        if (digit > 9) {
+            break;
+        }
+
+        result = result * 10 + digit;
+    }
+
+    if (count < min_count) {
+        invalid_datetime();
+    }
+
+    return result;
+}
+
+/**
+ * Read exactly count digits
+ */
+int64_t read_digits(const char *&pos, const char *end, size_t count) {
+    return read_digits(pos, end, count, count);
+}
+
+void expect(const char *&pos, const char *end, char c) {
+    if (pos == end || *pos != c) {
+        invalid_datetime();
+    }
+
+    ++pos;
+}
+
+void append_digits(std::string &out, int64_t value, size_t count) {
+    char buffer[8];
+
+    for (size_t i = count; i > 0; --i) {
+        buffer[i - 1] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+
+    out.append(buffer, count);
+}
+
+} // namespace
+
+const char *read_iso8601(const char *pos, const char *end,
+                         timestamp_t &value) {
+    const int64_t year = read_digits(pos, end, 4);
+    expect(pos, end, '-');
+    const int64_t month = read_digits(pos, end, 1, 2);
+    expect(pos, end, '-');
+    const int64_t day = read_digits(pos, end, 1, 2);
+
+    if (month < 1 || month > 12 || day < 1 ||
+        day > days_in_month(year, month)) {
+        invalid_datetime();
+    }
+
+    int64_t seconds = 0;
+    int64_t micros = 0;
+    int64_t offset = 0;
+
+    if (pos != end && (*pos == 'T' || *pos == ' ')) {
+        ++pos;
+
+        const int64_t hour = read_digits(pos, end, 1, 2);
+        expect(pos, end, ':');
+        const int64_t minute = read_digits(pos, end, 1, 2);
+        expect(pos, end, ':');
+        const int64_t second = read_digits(pos, end, 1, 2);
+
+        if (hour > 23 || minute > 59 || second > 59) {
+            invalid_datetime();
+        }
+
+        seconds = hour * 3600 + minute * 60 + second;
+
+        if (pos != end && *pos == '.') {
+            ++pos;
+
+            // Digits past microseconds are dropped
+            int64_t scale = MICROS_PER_SECOND;
+            const char *start = pos;
+
+            for (; pos != end && *pos >= '0' && *pos <= '9'; ++pos) {
+                scale /= 10;
+                micros += (*pos - '0') * scale;
+            }
+
+            if (pos == start) {
+                invalid_datetime();
+            }
+        }
+
+        if (pos != end && *pos == 'Z') {
+            ++pos;
+        } else if (pos != end && (*pos == '+' || *pos == '-')) {
+            const int64_t sign = *pos == '-' ? -1 : 1;
+            ++pos;
+
+            const int64_t offset_hours = read_digits(pos, end, 2);
+
+            if (pos != end && *pos == ':') {
+                ++pos;
+            }
+
+            const int64_t offset_minutes = read_digits(pos, end, 2);
+
+            if (offset_hours > 23 || offset_minutes > 59) {
+                invalid_datetime();
+            }
+
+            offset = sign * (offset_hours * 60 + offset_minutes);
+        }
+    }
+
+    seconds += days_from_civil(year, month, day) * SECONDS_PER_DAY;
+    seconds -= offset * 60;
+
+    value.micros = seconds * MICROS_PER_SECOND + micros;
+    value.utc_offset = static_cast<int16_t>(offset);
+
+    return pos;
+}
+
+void append_iso8601(std::string &out, const timestamp_t &value) {
+    const int64_t local =
+        value.micros + int64_t{value.utc_offset} * 60 * MICROS_PER_SECOND;
+
+    int64_t days = local / MICROS_PER_DAY;
+    int64_t micros = local % MICROS_PER_DAY;
+
+    if (micros < 0) {
+        micros += MICROS_PER_DAY;
+        --days;
+    }
+
+    int64_t year = 0, month = 0, day = 0;
+    civil_from_days(days, year, month, day);
+
+    const int64_t seconds = micros / MICROS_PER_SECOND;
+    micros %= MICROS_PER_SECOND;
+
+    if (year >= 0 && year <= 9999) {
+        append_digits(out, year, 4);
+    } else {
+        out += std::to_string(year);
+    }
+
+    out += '-';
+    append_digits(out, month, 2);
+    out += '-';
+    append_digits(out, day, 2);
+    out += ' ';
+    append_digits(out, seconds / 3600, 2);
+    out += ':';
+    append_digits(out, seconds / 60 % 60, 2);
+    out += ':';
+    append_digits(out, seconds % 60, 2);
+
+    if (micros != 0) {
+        out += '.';
+        append_digits(out, micros, 6);
+    }
+
+    if (value.utc_offset != 0) {
+        const int64_t offset =
+            value.utc_offset < 0 ? -value.utc_offset : value.utc_offset;
+
+        out += value.utc_offset < 0 ? '-' : '+';
+        append_digits(out, offset / 60, 2);
+        out += ':';
+        append_digits(out, offset % 60, 2);
+    }
+}
+
+timestamp_t to_timestamp(const tm &value) {
+    const int64_t days =
+        days_from_civil(value.tm_year, value.tm_mon, value.tm_mday);
+
+    timestamp_t result;
+    result.micros = (days * SECONDS_PER_DAY + value.tm_hour * 3600 +
+                     value.tm_min * 60 + value.tm_sec) *
+                    MICROS_PER_SECOND;
+
+    return result;
+}
+
+tm to_tm(const timestamp_t &value) {
+    const int64_t local = value.micros / MICROS_PER_SECOND +
+                          int64_t{value.utc_offset} * 60 -
+                          (value.micros % MICROS_PER_SECOND < 0 ? 1 : 0);
+
+    int64_t days = local / SECONDS_PER_DAY;
+    int64_t seconds = local % SECONDS_PER_DAY;
+
+    if (seconds < 0) {
+        seconds += SECONDS_PER_DAY;
+        --days;
+    }
+
+    int64_t year = 0, month = 0, day = 0;
+    civil_from_days(days, year, month, day);
+
+    tm result;
+    memset(&result, 0, sizeof(result));
+
+    result.tm_year = static_cast<int>(year);
+    result.tm_mon = static_cast<int>(month);
+    result.tm_mday = static_cast<int>(day);
+    result.tm_hour = static_cast<int>(seconds / 3600);
+    result.tm_min = static_cast<int>(seconds / 60 % 60);
+    result.tm_sec = static_cast<int>(seconds % 60);
+
+    return result;
+}
+
+} // namespace json
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "json/defines.h"
+
+#include <string>
+
+namespace json {
+
+/**
+ * Decode an ISO-8601 date and time, e.g. 2020-01-02T03:04:05.678+01:00
+ *
+ * Date and time may also be separated by a space, and the time can be left
+ * out entirely. Fractions of a second are kept up to microseconds. Values
+ * without a time zone are UTC. All fields but the year and the offset may
+ * have a single digit, as in 2020-1-5T3:04:05.
+ *
+ * \returns a pointer to the first character after the datetime
+ * \throws json_parse_error if the text is not a valid datetime
+ */
+const char *read_iso8601(const char *pos, const char *end,
+                         timestamp_t &value);
+
+/**
+ * Encode a timestamp as ISO-8601 in the time zone it was written in
+ *
+ * The format is "YYYY-MM-DD hh:mm:ss", followed by microseconds and the
+ * offset from UTC if they are not zero.
+ */
+void append_iso8601(std::string &out, const timestamp_t &value);
+
+/**
+ * Convert from the old datetime encoding
+ *
+ * Like Parser used to, the fields are expected to hold the calendar values
+ * as written, i.e. tm_year is not relative to 1900 and tm_mon starts at 1.
+ * The value is assumed to be UTC.
+ */
+timestamp_t to_timestamp(const tm &value);
+
+/**
+ * Convert to local time in the time zone of the value, using the same
+ * conventions as to_timestamp()
+ */
+tm to_tm(const timestamp_t &value);
+
+} // namespace json
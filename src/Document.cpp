@@ -1,17 +1,43 @@
+#include "CompactFormat.h"
+#include "Datetime.h"
 #include "DocumentMerger.h"
+#include "DocumentRewriter.h"
+#include "IndexedParser.h"
+#include "KeyDictionary.h"
 #include "Iterator.h"
-#include "Parser.h"
+#include "PathIndex.h"
+#include "PathSearch.h"
 #include "PredicateChecker.h"
+#include "ProjectingParser.h"
 #include "Projection.h"
 #include "Search.h"
+#include "TypedArray.h"
+#include "Validator.h"
 #include "helper.h"
 #include "json.h"
+#include "json/DocumentParser.h"
 
 #include <cctype>
 #include <ctime>
 
 namespace json {
 
+/**
+ * Offsets of every child of a map or array, relative to the start of the
+ * document
+ *
+ * For maps, the offsets point to the key of each entry.
+ */
+class ChildIndex {
+  public:
+    explicit ChildIndex(const bitstream &content);
+
+    uint32_t operator[](size_t pos) const { return m_offsets[pos]; }
+
+  private:
+    std::vector<uint32_t> m_offsets;
+};
+
 inline void skip_child(bitstream &view) {
     ObjectType ctype;
     view >> ctype;
@@ -24,6 +50,10 @@ inline void skip_child(bitstream &view) {
 #endif
     case ObjectType::Binary:
     case ObjectType::Map:
+    case ObjectType::SortedMap:
+    case ObjectType::KeyDictionary:
+    case ObjectType::DictionaryMap:
+    case ObjectType::TypedArray:
     case ObjectType::Array:
     case ObjectType::String: {
         uint32_t byte_size;
@@ -44,28 +74,268 @@ inline void skip_child(bitstream &view) {
     case ObjectType::Datetime:
         view.move_by(sizeof(tm));
         break;
+    case ObjectType::Timestamp:
+        view.move_by(TIMESTAMP_SIZE);
+        break;
     default:
         throw json_error("Unknown document type!");
     }
 }
 
+/**
+ * Read the type of the value at the current position, stepping into the key
+ * dictionary that it might be wrapped in
+ */
+inline ObjectType read_type(bitstream &view, KeyDictionary &keys) {
+    ObjectType type;
+    view >> type;
+
+    while (type == ObjectType::KeyDictionary) {
+        keys.load(view);
+        view >> type;
+    }
+
+    return type;
+}
+
+/**
+ * Copy the value at the current position along with the key dictionary that
+ * it refers to
+ *
+ * \returns false, without copying anything, if the value does not refer to
+ *          the dictionary
+ */
+inline bool copy_with_keys(const KeyDictionary &keys, const bitstream &view,
+                           bitstream &result) {
+    const uint8_t *start = view.current();
+
+    if (!keys.loaded() ||
+        !KeyDictionary::uses_keys(static_cast<ObjectType>(*start))) {
+        return false;
+    }
+
+    bitstream child;
+    child.assign(start, view.remaining_size(), true);
+    skip_child(child);
+
+    keys.wrap(start, child.pos(), result);
+    result.move_to(0);
+    return true;
+}
+
+/**
+ * Copy an element of the typed array at the current position
+ *
+ * The view has to be placed at the first value. Elements do not have a type
+ * of their own, so they cannot be viewed in place.
+ */
+inline void copy_typed_element(bitstream &view, ObjectType element_type,
+                               size_t pos, bitstream &result) {
+    view.move_by(pos * TYPED_ARRAY_ELEMENT_SIZE);
+
+    result << element_type;
+    result.write_raw_data(view.current(), TYPED_ARRAY_ELEMENT_SIZE);
+    result.move_to(0);
+}
+
+/**
+ * The values of the typed array at the start of the content
+ *
+ * Values that are not aligned, e.g. in a copy of a view, are copied to
+ * aligned_copy once. The copy is kept until the document changes.
+ */
+template <typename T>
+std::span<const T> typed_values(const bitstream &content,
+                                ObjectType element_type,
+                                std::atomic<const void *> &aligned_copy) {
+    bitstream view;
+    view.assign(content.data(), content.size(), true);
+
+    ObjectType type;
+    view >> type;
+
+    if (type != ObjectType::TypedArray) {
+        throw json_error("Not a typed array");
+    }
+
+    ObjectType actual_type;
+    uint32_t size;
+    read_typed_array(view, actual_type, size);
+
+    if (actual_type != element_type) {
+        throw json_error("Typed array holds values of another type");
+    }
+
+    if (reinterpret_cast<uintptr_t>(view.current()) % alignof(T) == 0) {
+        return std::span<const T>(reinterpret_cast<const T *>(view.current()),
+                                  size);
+    }
+
+    const void *values = aligned_copy.load(std::memory_order_acquire);
+
+    if (values == nullptr) {
+        // Memory from operator new is aligned for any of the value types
+        void *created = ::operator new(size * sizeof(T));
+        memcpy(created, view.current(), size * sizeof(T));
+
+        if (aligned_copy.compare_exchange_strong(values, created,
+                                                 std::memory_order_acq_rel)) {
+            values = created;
+        } else {
+            ::operator delete(created);
+        }
+    }
+
+    return std::span<const T>(static_cast<const T *>(values), size);
+}
+
+ChildIndex::ChildIndex(const bitstream &content) {
+    bitstream view;
+    view.assign(content.data(), content.size(), true);
+
+    KeyDictionary keys;
+    const ObjectType type = read_type(view, keys);
+
+    uint32_t byte_size, size;
+    view >> byte_size >> size;
+    DocumentTraversal::skip_key_table(type, size, view);
+
+    m_offsets.resize(size);
+
+    for (uint32_t i = 0; i < size; ++i) {
+        m_offsets[i] = view.pos();
+
+        if (type != ObjectType::Array) {
+            keys.read_key(type, view);
+        }
+
+        skip_child(view);
+    }
+}
+
 #ifndef IS_ENCLAVE
 Document::Document(std::ifstream &file) { m_content << file; }
 #endif
 
-Document::Document(const std::string &str) {
+Document::Document(const std::string &str) : Document(parse(str)) {}
+
+Document Document::parse(std::string_view str) {
+    Document doc;
+
     if (str.empty()) {
-        m_content << ObjectType::Null;
+        doc.m_content << ObjectType::Null;
     } else {
-        Parser parser(str, m_content);
+        reserve(doc.m_content, str.size());
+
+        IndexedParser parser(str, doc.m_content);
         parser.do_parse();
     }
 
-    m_content.move_to(0);
+    doc.m_content.move_to(0);
+    return doc;
+}
+
+Document Document::parse(const char *data, size_t length) {
+    return parse(std::string_view(data, length));
+}
+
+Document Document::parse(std::string_view str,
+                         const std::vector<std::string> &paths) {
+    if (str.empty()) {
+        return parse(str);
+    }
+
+    Document doc;
+    path_node root;
+
+    for (auto &path : paths) {
+        root.add(path);
+    }
+
+    ProjectingParser parser(str, doc.m_content, root);
+
+    if (!parser.do_parse()) {
+        return Document(parse(str), paths);
+    }
+
+    doc.m_content.move_to(0);
+    return doc;
+}
+
+ParseError Document::try_parse(std::string_view str, Document &result,
+                               const ParseOptions &options) {
+    DocumentParser parser(options);
+    return parser.try_parse(str, result);
 }
 
 Document::Document(Document &&other) noexcept
-    : m_content(std::move(other.m_content)) {}
+    : m_content(std::move(other.m_content)),
+      m_child_index(other.m_child_index.exchange(nullptr)),
+      m_path_index(other.m_path_index.exchange(nullptr)),
+      m_aligned_copy(other.m_aligned_copy.exchange(nullptr)),
+      m_trusted(other.m_trusted.exchange(false)) {}
+
+Document::~Document() { invalidate_indexes(); }
+
+void Document::operator=(Document &&other) {
+    invalidate_indexes();
+
+    // The buffer moves along, so the offsets stay valid
+    m_content = std::move(other.m_content);
+    m_child_index = other.m_child_index.exchange(nullptr);
+    m_path_index = other.m_path_index.exchange(nullptr);
+    m_aligned_copy = other.m_aligned_copy.exchange(nullptr);
+    m_trusted = other.m_trusted.exchange(false);
+}
+
+void Document::invalidate_indexes() {
+    delete m_child_index.exchange(nullptr);
+    delete m_path_index.exchange(nullptr);
+    ::operator delete(const_cast<void *>(m_aligned_copy.exchange(nullptr)));
+    m_trusted = false;
+}
+
+void Document::build_path_index() const {
+    if (m_path_index.load(std::memory_order_acquire) != nullptr ||
+        m_content.empty()) {
+        return;
+    }
+
+    auto *created = new PathIndex(m_content);
+    const PathIndex *expected = nullptr;
+
+    if (!m_path_index.compare_exchange_strong(expected, created,
+                                              std::memory_order_acq_rel)) {
+        delete created;
+    }
+}
+
+size_t Document::path_index_memory() const {
+    const PathIndex *index = m_path_index.load(std::memory_order_acquire);
+    return index == nullptr ? 0 : index->memory_usage();
+}
+
+const ChildIndex *Document::child_index(uint32_t size) const {
+    if (size < CHILD_INDEX_THRESHOLD) {
+        return nullptr;
+    }
+
+    const ChildIndex *index = m_child_index.load(std::memory_order_acquire);
+
+    if (index != nullptr) {
+        return index;
+    }
+
+    auto *created = new ChildIndex(m_content);
+
+    if (m_child_index.compare_exchange_strong(index, created,
+                                              std::memory_order_acq_rel)) {
+        return created;
+    }
+
+    delete created;
+    return index;
+}
 
 Document::Document(bitstream &data) {
     uint32_t size = 0;
@@ -77,6 +347,21 @@ Document::Document(bitstream &data) {
     m_content.move_to(0);
 }
 
+bool Document::validate() const {
+    if (trusted()) {
+        return true;
+    }
+
+    Validator validator(m_content.data(), m_content.size());
+
+    if (!validator.validate()) {
+        return false;
+    }
+
+    m_trusted.store(true, std::memory_order_release);
+    return true;
+}
+
 bool Document::valid() const {
     if (m_content.empty()) {
         return false;
@@ -104,6 +389,8 @@ bool Document::matches_predicates(const json::Document &predicates) const {
 }
 
 bool Document::insert(const std::string &path, const Document &doc) {
+    invalidate_indexes();
+
     DocumentMerger merger(m_content, path, doc.m_content);
     return merger.do_merge();
 }
@@ -125,6 +412,21 @@ void Document::compress(bitstream &bstream) const {
     }
 }
 
+void Document::to_compact(bitstream &result) const {
+    CompactEncoder encoder(result);
+    encoder.encode(m_content);
+}
+
+Document Document::from_compact(const uint8_t *data, uint32_t length) {
+    Document doc;
+
+    CompactDecoder decoder(data, length, doc.m_content);
+    decoder.decode();
+
+    doc.m_content.move_to(0);
+    return doc;
+}
+
 void Document::iterate(json::Iterator &iterator) const {
     json::IterationEngine engine(data(), iterator);
     engine.run();
@@ -160,8 +462,21 @@ Document::Document(const Document &parent, const uint32_t pos) {
     bitstream view;
     view.assign(parent.m_content.data(), parent.m_content.size(), true);
 
-    ObjectType type;
-    view >> type;
+    KeyDictionary keys;
+    const ObjectType type = read_type(view, keys);
+
+    if (type == ObjectType::TypedArray) {
+        ObjectType element_type;
+        uint32_t size;
+        read_typed_array(view, element_type, size);
+
+        if (pos >= size) {
+            throw json_error("out of array bounds!");
+        }
+
+        copy_typed_element(view, element_type, pos, m_content);
+        return;
+    }
 
     if (type != ObjectType::Array) {
         throw json_error("Not an array");
@@ -174,10 +489,18 @@ Document::Document(const Document &parent, const uint32_t pos) {
         throw json_error("out of array bounds!");
     }
 
-    for (uint32_t i = 0; i < pos; ++i) {
-        ObjectType ot;
-        view >> ot;
-        DocumentTraversal::skip_next(ot, view);
+    if (auto index = parent.child_index(size)) {
+        view.move_to((*index)[pos]);
+    } else {
+        for (uint32_t i = 0; i < pos; ++i) {
+            ObjectType ot;
+            view >> ot;
+            DocumentTraversal::skip_next(ot, view);
+        }
+    }
+
+    if (copy_with_keys(keys, view, m_content)) {
+        return;
     }
 
     auto start = view.current();
@@ -202,6 +525,11 @@ Document::Document(const Document &parent, const std::string &path,
         if (num_found != paths.size() && force) {
             throw json_error("Not all paths were found");
         }
+    } else if (auto index = parent.m_path_index.load(std::memory_order_acquire);
+               index != nullptr && !path.empty()) {
+        if (!index->find(path, parent.m_content, m_content) && force) {
+            throw json_error("Path was not found");
+        }
     } else {
         Search search(parent, path);
         bool success = search.do_search();
@@ -214,6 +542,34 @@ Document::Document(const Document &parent, const std::string &path,
     }
 }
 
+Document::Document(const Document &parent, const Path &path, bool force) {
+    if (auto index = parent.m_path_index.load(std::memory_order_acquire);
+        index != nullptr && path.size() > 0) {
+        if (!index->find(path.str(), parent.m_content, m_content) && force) {
+            throw json_error("Path was not found");
+        }
+        return;
+    }
+
+    PathSearch search(parent, path);
+    bool success = search.do_search();
+
+    if (!success && force) {
+        throw json_error("Path was not found");
+    }
+
+    m_content = search.get_result();
+}
+
+std::vector<Document> Document::lookup(const PathSet &paths) const {
+    std::vector<Document> results(paths.size());
+
+    PathSetSearch search(*this, paths);
+    search.do_search(results);
+
+    return results;
+}
+
 Document::Document(uint8_t *data, uint32_t length, DocumentMode mode) {
     if (mode == DocumentMode::ReadOnly) {
         m_content.assign(data, length, true);
@@ -256,6 +612,8 @@ Diff::Diff(DiffType type, const std::string &path, const uint8_t *value,
 }
 
 bool Document::add(const std::string &path, const json::Document &value) {
+    invalidate_indexes();
+
     DocumentAdd adder(m_content, path, value);
 
     try {
@@ -272,15 +630,33 @@ json::Document Document::get_child(size_t pos) const {
     bitstream view;
     view.assign(m_content.data(), m_content.size(), true);
 
-    std::vector<std::string> result;
+    KeyDictionary keys;
+    const ObjectType type = read_type(view, keys);
 
-    ObjectType type;
-    view >> type;
+    if (type == ObjectType::TypedArray) {
+        ObjectType element_type;
+        uint32_t size;
+        read_typed_array(view, element_type, size);
+
+        if (pos >= size) {
+            throw std::invalid_argument("Position is out of bounds!");
+        }
 
-    if (type != ObjectType::Map && type != ObjectType::Array) {
+        bitstream element;
+        copy_typed_element(view, element_type, pos, element);
+
+        json::Document child;
+        child.assign(std::move(element));
+        return child;
+    }
+
+    if (type != ObjectType::Map && type != ObjectType::SortedMap &&
+        type != ObjectType::DictionaryMap && type != ObjectType::Array) {
         throw json_error("Document is not a map or array");
     }
 
+    const bool is_map = type != ObjectType::Array;
+
     uint32_t byte_size, size;
     view >> byte_size >> size;
 
@@ -288,17 +664,34 @@ json::Document Document::get_child(size_t pos) const {
         throw std::invalid_argument("Position is out of bounds!");
     }
 
-    for (uint32_t i = 0; i < size; ++i) {
-        if (type == ObjectType::Map) {
-            std::string key;
-            view >> key;
-        }
+    if (auto index = child_index(size)) {
+        view.move_to((*index)[pos]);
 
-        if (i == pos) {
-            break;
-        } else {
-            skip_child(view);
+        if (is_map) {
+            keys.read_key(type, view);
         }
+    } else {
+        DocumentTraversal::skip_key_table(type, size, view);
+
+        for (uint32_t i = 0; i < size; ++i) {
+            if (is_map) {
+                keys.read_key(type, view);
+            }
+
+            if (i == pos) {
+                break;
+            } else {
+                skip_child(view);
+            }
+        }
+    }
+
+    bitstream wrapped;
+
+    if (copy_with_keys(keys, view, wrapped)) {
+        json::Document child;
+        child.assign(std::move(wrapped));
+        return child;
     }
 
     return json::Document(view.current(), view.remaining_size(),
@@ -306,13 +699,18 @@ json::Document Document::get_child(size_t pos) const {
 }
 
 std::string Document::get_key(size_t pos) const {
+    return std::string(key_view(pos));
+}
+
+std::string_view Document::key_view(size_t pos) const {
     bitstream view;
     view.assign(m_content.data(), m_content.size(), true);
 
-    ObjectType type;
-    view >> type;
+    KeyDictionary keys;
+    const ObjectType type = read_type(view, keys);
 
-    if (type != ObjectType::Map) {
+    if (type != ObjectType::Map && type != ObjectType::SortedMap &&
+        type != ObjectType::DictionaryMap) {
         throw json_error("Document is not a map");
     }
 
@@ -323,31 +721,153 @@ std::string Document::get_key(size_t pos) const {
         throw std::invalid_argument("Position is out of bounds!");
     }
 
-    for (uint32_t i = 0; i < size; ++i) {
-        if (i == pos) {
-            break;
-        } else {
-            std::string key;
-            view >> key;
+    if (auto index = child_index(size)) {
+        view.move_to((*index)[pos]);
+    } else {
+        DocumentTraversal::skip_key_table(type, size, view);
 
+        for (uint32_t i = 0; i < pos; ++i) {
+            keys.read_key(type, view);
             skip_child(view);
         }
     }
 
-    std::string key;
-    view >> key;
-    return key;
+    return keys.read_key(type, view);
+}
+
+ChildIterator Document::begin() const { return ChildIterator(*this, false); }
+
+ChildIterator Document::end() const { return ChildIterator(*this, true); }
+
+static_assert(std::forward_iterator<ChildIterator>);
+
+ChildIterator::ChildIterator(const Document &document, bool at_end)
+    : m_document(&document) {
+    bitstream view;
+    view.assign(document.m_content.data(), document.m_content.size(), true);
+
+    view >> m_type;
+
+    while (m_type == ObjectType::KeyDictionary) {
+        m_dictionary = view.pos();
+
+        KeyDictionary keys;
+        keys.load(view);
+        view >> m_type;
+    }
+
+    if (m_type == ObjectType::TypedArray) {
+        read_typed_array(view, m_element_type, m_size);
+    } else if (m_type == ObjectType::Map || m_type == ObjectType::SortedMap ||
+               m_type == ObjectType::DictionaryMap ||
+               m_type == ObjectType::Array) {
+        uint32_t byte_size;
+        view >> byte_size >> m_size;
+        DocumentTraversal::skip_key_table(m_type, m_size, view);
+    } else {
+        throw json_error("Document is not a map or array");
+    }
+
+    m_offset = view.pos();
+    m_index = at_end ? m_size : 0;
+}
+
+ChildIterator::Entry ChildIterator::operator*() const {
+    const auto &content = m_document->m_content;
+
+    if (m_index >= m_size) {
+        throw std::invalid_argument("Position is out of bounds!");
+    }
+
+    bitstream view;
+    view.assign(content.data(), content.size(), true);
+
+    if (m_type == ObjectType::TypedArray) {
+        view.move_to(m_offset);
+
+        bitstream element;
+        copy_typed_element(view, m_element_type, m_index, element);
+
+        Entry entry;
+        entry.value.assign(std::move(element));
+        return entry;
+    }
+
+    KeyDictionary keys;
+
+    if (m_dictionary > 0) {
+        view.move_to(m_dictionary);
+        keys.load(view);
+    }
+
+    view.move_to(m_offset);
+
+    std::string_view key;
+
+    if (m_type != ObjectType::Array) {
+        key = keys.read_key(m_type, view);
+    }
+
+    bitstream wrapped;
+
+    if (copy_with_keys(keys, view, wrapped)) {
+        Entry entry{key, Document()};
+        entry.value.assign(std::move(wrapped));
+        return entry;
+    }
+
+    // Views of exactly one value, so that they are valid on their own
+    const uint32_t start = view.pos();
+    skip_child(view);
+
+    return Entry{key, Document(content.data() + start, view.pos() - start,
+                               DocumentMode::ReadOnly)};
+}
+
+ChildIterator &ChildIterator::operator++() {
+    if (m_index >= m_size) {
+        throw std::invalid_argument("Position is out of bounds!");
+    }
+
+    ++m_index;
+
+    // Elements of typed arrays are found by their index
+    if (m_type == ObjectType::TypedArray) {
+        return *this;
+    }
+
+    const auto &content = m_document->m_content;
+
+    bitstream view;
+    view.assign(content.data(), content.size(), true);
+    view.move_to(m_offset);
+
+    if (m_type != ObjectType::Array) {
+        if (m_type == ObjectType::DictionaryMap) {
+            view.move_by(sizeof(key_id_t));
+        } else {
+            uint32_t length;
+            view >> length;
+            view.move_by(length);
+        }
+    }
+
+    skip_child(view);
+    m_offset = view.pos();
+    return *this;
 }
 
 uint32_t Document::get_size() const {
     bitstream view;
     view.assign(m_content.data(), m_content.size(), true);
 
-    ObjectType type;
-    view >> type;
+    KeyDictionary keys;
 
-    switch (type) {
+    switch (read_type(view, keys)) {
     case ObjectType::Map:
+    case ObjectType::SortedMap:
+    case ObjectType::DictionaryMap:
+    case ObjectType::TypedArray:
     case ObjectType::Array: {
         uint32_t byte_size, size;
         view >> byte_size >> size;
@@ -366,10 +886,14 @@ ObjectType Document::get_type() const {
         return ObjectType::Null;
     }
 
-    ObjectType type;
-    view >> type;
+    KeyDictionary keys;
+    return read_type(view, keys);
+}
 
-    return type;
+bool Document::uses_key_dictionary() const {
+    return !m_content.empty() &&
+           static_cast<ObjectType>(m_content.data()[0]) ==
+               ObjectType::KeyDictionary;
 }
 
 bitstream Document::as_bitstream() const {
@@ -405,6 +929,23 @@ const uint8_t *Document::as_binary() const {
     return view.current();
 }
 
+std::span<const uint8_t> Document::as_binary_span() const {
+    bitstream view;
+    view.assign(m_content.data(), m_content.size(), true);
+
+    ObjectType type;
+    view >> type;
+
+    if (type != ObjectType::Binary) {
+        throw json_error("Not a binary object");
+    }
+
+    uint32_t size;
+    view >> size;
+
+    return std::span<const uint8_t>(view.current(), size);
+}
+
 json::integer_t Document::as_integer() const {
     bitstream view;
     view.assign(m_content.data(), m_content.size(), true);
@@ -453,6 +994,94 @@ bool Document::as_boolean() const {
     }
 }
 
+timestamp_t Document::as_timestamp() const {
+    bitstream view;
+    view.assign(m_content.data(), m_content.size(), true);
+
+    ObjectType type;
+    view >> type;
+
+    if (type == ObjectType::Datetime) {
+        tm value;
+        view >> value;
+        return to_timestamp(value);
+    } else if (type != ObjectType::Timestamp) {
+        throw json_error("Not a datetime!");
+    }
+
+    timestamp_t value;
+    view >> value.micros >> value.utc_offset;
+    return value;
+}
+
+std::span<const integer_t> Document::as_integer_span() const {
+    return typed_values<integer_t>(m_content, ObjectType::Integer,
+                                   m_aligned_copy);
+}
+
+std::span<const json::float_t> Document::as_float_span() const {
+    return typed_values<json::float_t>(m_content, ObjectType::Float,
+                                       m_aligned_copy);
+}
+
+void Document::sort_map_keys(uint32_t min_size) {
+    if (m_content.empty()) {
+        return;
+    }
+
+    bitstream view;
+    view.assign(m_content.data(), m_content.size(), true);
+
+    bitstream result;
+    Writer writer(result);
+    writer.set_sorted_map_threshold(min_size);
+
+    DocumentRewriter(writer, false, false).copy(view, "");
+
+    result.move_to(0);
+    assign(std::move(result));
+}
+
+void Document::use_key_dictionary(bool enabled) {
+    if (m_content.empty() || uses_key_dictionary() == enabled) {
+        return;
+    }
+
+    bitstream view;
+    view.assign(m_content.data(), m_content.size(), true);
+
+    bitstream result;
+    Writer writer(result);
+    writer.set_key_dictionary(enabled);
+
+    DocumentRewriter(writer, false, true).copy(view, "");
+
+    result.move_to(0);
+    assign(std::move(result));
+}
+
+size_t Document::convert_datetimes() {
+    if (m_content.empty()) {
+        return 0;
+    }
+
+    bitstream view;
+    view.assign(m_content.data(), m_content.size(), true);
+
+    bitstream result;
+    Writer writer(result);
+    writer.set_key_dictionary(uses_key_dictionary());
+
+    const size_t count = DocumentRewriter(writer, true, true).copy(view, "");
+
+    if (count > 0) {
+        result.move_to(0);
+        assign(std::move(result));
+    }
+
+    return count;
+}
+
 #ifdef USE_GEO
 geo::vector2d Document::as_vector2() const {
     bitstream view;
@@ -475,6 +1104,10 @@ geo::vector2d Document::as_vector2() const {
 #endif
 
 std::string Document::as_string() const {
+    return std::string(as_string_view());
+}
+
+std::string_view Document::as_string_view() const {
     bitstream view;
     view.assign(m_content.data(), m_content.size(), true);
 
@@ -485,12 +1118,25 @@ std::string Document::as_string() const {
         throw json_error("Not a string!");
     }
 
-    std::string str;
-    view >> str;
-    return str;
+    uint32_t length;
+    view >> length;
+
+    return std::string_view(reinterpret_cast<const char *>(view.current()),
+                            length);
 }
 
 Diffs Document::diff(const Document &other) const {
+    // Keys are compared as strings, so both sides have to hold them inline
+    if (uses_key_dictionary() || other.uses_key_dictionary()) {
+        auto first = duplicate(true);
+        auto second = other.duplicate(true);
+
+        first.use_key_dictionary(false);
+        second.use_key_dictionary(false);
+
+        return first.diff(second);
+    }
+
     Diffs diffs;
     DocumentDiffs runner(m_content, other.m_content);
     runner.create_diffs(diffs);
@@ -125,6 +125,11 @@ class DocumentMerger : public DocumentTraversal {
                 m_doc.move_by(byte_size - sizeof(size));
                 m_success = true;
                 return true;
+            } else if (type == ObjectType::SortedMap ||
+                       type == ObjectType::KeyDictionary ||
+                       type == ObjectType::DictionaryMap ||
+                       type == ObjectType::TypedArray) {
+                return reject(type);
             } else
                 return true;
         } else {
@@ -132,6 +137,11 @@ class DocumentMerger : public DocumentTraversal {
             case ObjectType::Map:
                 return parse_map();
                 break;
+            case ObjectType::SortedMap:
+            case ObjectType::KeyDictionary:
+            case ObjectType::DictionaryMap:
+            case ObjectType::TypedArray:
+                return reject(type);
             case ObjectType::Array:
                 return parse_array();
                 break;
@@ -142,6 +152,15 @@ class DocumentMerger : public DocumentTraversal {
     }
 
   private:
+    /// These encodings cannot be changed in place, so the merge fails
+    bool reject(ObjectType type) {
+        skip_next(type, m_doc);
+
+        // Nothing after this may match the rest of the path
+        path.clear();
+        return true;
+    }
+
     void insert_into_map(const std::string &key, const bitstream &data,
                          uint32_t start) {
         m_doc.make_space(data.size() + sizeof(uint32_t) + key.size());
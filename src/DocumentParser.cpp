@@ -0,0 +1,86 @@
+#include "json/DocumentParser.h"
+#include "IndexedParser.h"
+#include "json.h"
+
+#include <algorithm>
+
+namespace json {
+
+DocumentParser::DocumentParser(const ParseOptions &options)
+    : m_options(options) {}
+
+DocumentParser::~DocumentParser() = default;
+
+void DocumentParser::parse(std::string_view str, Document &doc) {
+    auto &content = doc.mutable_data();
+    content.clear();
+
+    parse(str, content, str.size());
+
+    content.move_to(0);
+}
+
+void DocumentParser::parse(std::string_view str, bitstream &output) {
+    parse(str, output, str.size());
+}
+
+void DocumentParser::parse(std::string_view str, bitstream &output,
+                           size_t capacity) {
+    if (str.empty()) {
+        output << ObjectType::Null;
+        return;
+    }
+
+    reserve(output, capacity);
+
+    if (m_parser) {
+        m_parser->reset(str, output, IndexKernel::Best,
+                        m_options.validate_utf8);
+    } else {
+        m_parser = std::make_unique<IndexedParser>(
+            str, output, IndexKernel::Best, m_options.validate_utf8);
+    }
+
+    m_parser->do_parse();
+}
+
+ParseError DocumentParser::try_parse(std::string_view str, Document &doc) {
+    auto &content = doc.mutable_data();
+    content.clear();
+
+    ParseError error;
+
+    try {
+        // Input that is rejected early should not cost a large allocation
+        parse(str, content, std::min(str.size(), INDEX_WINDOW_SIZE));
+
+        // Empty input is not handed to the parser
+        if (!str.empty()) {
+            m_parser->finish_input();
+        }
+
+        content.move_to(0);
+        return error;
+    } catch (const json_parse_error &e) {
+        size_t offset = str.size();
+
+        // The index fails before the parser has looked at anything
+        if (e.offset() != std::string::npos) {
+            offset = e.offset();
+        } else if (m_parser && e.code() != ParseErrorCode::UnexpectedEnd &&
+                   e.code() != ParseErrorCode::InputTooLarge) {
+            offset = m_parser->position();
+        }
+
+        error = Parser::make_error(e.code(), str, offset);
+    } catch (const json_error &) {
+        const size_t offset = m_parser ? m_parser->position() : 0;
+        error = Parser::make_error(ParseErrorCode::InvalidValue, str, offset);
+    }
+
+    // Nothing that was written before the error is kept
+    content.clear();
+    return error;
+}
+
+} // namespace json
@@ -1,4 +1,6 @@
+#include "Datetime.h"
 #include "Iterator.h"
+#include "StringDecoder.h"
 #include "json.h"
 
 #include "defines.h"
@@ -14,7 +16,7 @@ void DocumentPrettyPrinter::handle_string(const std::string &key,
     print_indent();
     print_key(key);
     m_res += '\"';
-    m_res += value;
+    append_escaped(m_res, value);
     m_res += '\"';
 }
 
@@ -102,6 +104,13 @@ void DocumentPrettyPrinter::handle_datetime(const std::string &key,
              to_string(value.tm_min, 2) + ":" + to_string(value.tm_sec, 2);
 }
 
+void DocumentPrettyPrinter::handle_timestamp(const std::string &key,
+                                             const timestamp_t &value) {
+    print_indent();
+    print_key(key);
+    append_iso8601(m_res, value);
+}
+
 void DocumentPrettyPrinter::print_key(const std::string &key) {
     if (key.empty()) {
         return;
@@ -112,7 +121,7 @@ void DocumentPrettyPrinter::print_key(const std::string &key) {
     }
 
     m_res += '\"';
-    m_res += key;
+    append_escaped(m_res, key);
     m_res += "\": ";
 }
 
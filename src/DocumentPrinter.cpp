@@ -1,4 +1,6 @@
+#include "Datetime.h"
 #include "Iterator.h"
+#include "StringDecoder.h"
 #include "json.h"
 
 #include "defines.h"
@@ -18,11 +20,15 @@ void Printer::handle_key(const std::string &key) {
     const auto &m = mode.top();
 
     if (m == FIRST_IN_MAP) {
-        result += '"' + key + "\":";
+        result += '"';
+        append_escaped(result, key);
+        result += "\":";
         mode.pop();
         mode.push(IN_MAP);
     } else if (m == IN_MAP) {
-        result += ",\"" + key + "\":";
+        result += ",\"";
+        append_escaped(result, key);
+        result += "\":";
     } else if (m == FIRST_IN_ARRAY) {
         mode.pop();
         mode.push(IN_ARRAY);
@@ -35,7 +41,9 @@ void Printer::handle_key(const std::string &key) {
 
 void Printer::handle_string(const std::string &key, const std::string &value) {
     handle_key(key);
-    result += '"' + value + '"';
+    result += '"';
+    append_escaped(result, value);
+    result += '"';
 }
 
 void Printer::handle_integer(const std::string &key, const integer_t value) {
@@ -97,6 +105,15 @@ void Printer::handle_datetime(const std::string &key, const tm &value) {
     result += '"';
 }
 
+void Printer::handle_timestamp(const std::string &key,
+                               const timestamp_t &value) {
+    handle_key(key);
+
+    result += "d\"";
+    append_iso8601(result, value);
+    result += '"';
+}
+
 void Printer::handle_map_end() {
     mode.pop();
     result += "}";
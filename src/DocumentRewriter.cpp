@@ -0,0 +1,79 @@
+#include "DocumentRewriter.h"
+#include "Datetime.h"
+#include "DocumentTraversal.h"
+
+namespace json {
+
+size_t DocumentRewriter::copy(bitstream &view, std::string_view key,
+                              const KeyDictionary &keys) {
+    const uint32_t start = view.pos();
+
+    ObjectType type;
+    view >> type;
+
+    size_t count = 0;
+
+    switch (type) {
+    case ObjectType::Datetime: {
+        if (!m_convert_datetimes) {
+            break;
+        }
+
+        tm value;
+        view >> value;
+        m_writer.write_timestamp(key, to_timestamp(value));
+        return 1;
+    }
+    case ObjectType::KeyDictionary: {
+        KeyDictionary inner;
+        inner.load(view);
+        return copy(view, key, inner);
+    }
+    case ObjectType::Map:
+    case ObjectType::SortedMap:
+    case ObjectType::DictionaryMap: {
+        uint32_t byte_size = 0, size = 0;
+        view >> byte_size >> size;
+        DocumentTraversal::skip_key_table(type, size, view);
+
+        m_writer.start_map(key);
+
+        for (uint32_t i = 0; i < size; ++i) {
+            const auto child_key = keys.read_key(type, view);
+            count += copy(view, child_key, keys);
+        }
+
+        if (m_keep_sorted && type == ObjectType::SortedMap) {
+            m_writer.end_sorted_map();
+        } else {
+            m_writer.end_map();
+        }
+
+        return count;
+    }
+    case ObjectType::Array: {
+        uint32_t byte_size = 0, size = 0;
+        view >> byte_size >> size;
+
+        m_writer.start_array(key);
+
+        for (uint32_t i = 0; i < size; ++i) {
+            count += copy(view, "", keys);
+        }
+
+        m_writer.end_array();
+        return count;
+    }
+    default:
+        break;
+    }
+
+    view.move_to(start);
+    view >> type;
+    DocumentTraversal::skip_next(type, view);
+
+    m_writer.write_raw_data(key, view.data() + start, view.pos() - start);
+    return 0;
+}
+
+} // namespace json
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <bitstream.h>
+
+#include "KeyDictionary.h"
+#include "json/Writer.h"
+
+#include <string_view>
+
+namespace json {
+
+/**
+ * Copies encoded values to a writer, re-encoding maps and old datetimes
+ *
+ * Maps are written in the form the writer is configured for. Keys of a value
+ * that uses a key dictionary are looked up in it, so that they can be written
+ * inline or into the dictionary of the writer.
+ */
+class DocumentRewriter {
+  public:
+    /**
+     * \param convert_datetimes
+     *      Replace datetimes in the old encoding with timestamps
+     * \param keep_sorted
+     *      Write sorted maps as sorted maps again. Otherwise, the threshold of
+     *      the writer decides for every map.
+     */
+    DocumentRewriter(Writer &writer, bool convert_datetimes, bool keep_sorted)
+        : m_writer(writer), m_convert_datetimes(convert_datetimes),
+          m_keep_sorted(keep_sorted) {}
+
+    /**
+     * Copy the next value of the view
+     *
+     * \param keys
+     *      The dictionary that the value refers to, if any
+     * \returns the number of datetimes that were replaced
+     */
+    size_t copy(bitstream &view, std::string_view key,
+                const KeyDictionary &keys = KeyDictionary());
+
+  private:
+    Writer &m_writer;
+    const bool m_convert_datetimes;
+    const bool m_keep_sorted;
+};
+
+} // namespace json
@@ -1,9 +1,15 @@
 #pragma once
 
+#include <bitstream.h>
+
 #include "defines.h"
 #include "json/defines.h"
 #include "json/json_error.h"
 
+#include <cstring>
+#include <string_view>
+#include <utility>
+
 using std::to_string;
 
 namespace json {
@@ -34,6 +40,10 @@ class DocumentTraversal {
         }
         case ObjectType::String:
         case ObjectType::Map:
+        case ObjectType::SortedMap:
+        case ObjectType::KeyDictionary:
+        case ObjectType::DictionaryMap:
+        case ObjectType::TypedArray:
         case ObjectType::Array: {
             uint32_t byte_size;
             view >> byte_size;
@@ -44,6 +54,10 @@ class DocumentTraversal {
             view.move_by(sizeof(tm));
             break;
         }
+        case ObjectType::Timestamp: {
+            view.move_by(TIMESTAMP_SIZE);
+            break;
+        }
         case ObjectType::True:
         case ObjectType::False:
         case ObjectType::Null:
@@ -52,6 +66,86 @@ class DocumentTraversal {
             throw json_error("Document traversal failed: Unknown object type");
         }
     }
+
+    /**
+     * Move past the key table of a sorted map
+     *
+     * The view has to be placed right after the entry count. Afterwards, the
+     * entries can be read in order like those of a regular map.
+     */
+    static void skip_key_table(ObjectType type, uint32_t size,
+                               bitstream &view) {
+        if (type == ObjectType::SortedMap) {
+            view.move_by(size * sizeof(uint32_t));
+        }
+    }
+
+    /**
+     * Look up a key of a sorted map with a binary search
+     *
+     * The view has to be placed right after the entry count. It is not
+     * moved.
+     *
+     * \returns the range [first, last) of key table positions that hold the
+     *      key. Equal keys are in the same order as in the map, so the last
+     *      one is found last by a linear search as well.
+     */
+    static std::pair<uint32_t, uint32_t>
+    find_sorted_keys(const bitstream &view, uint32_t size,
+                     std::string_view key) {
+        const uint8_t *table = view.current();
+        const uint8_t *entries = table + size * sizeof(uint32_t);
+
+        auto key_at = [&](uint32_t pos) {
+            uint32_t offset, length;
+            memcpy(&offset, table + pos * sizeof(uint32_t), sizeof(offset));
+            memcpy(&length, entries + offset, sizeof(length));
+
+            return std::string_view(
+                reinterpret_cast<const char *>(entries + offset +
+                                               sizeof(length)),
+                length);
+        };
+
+        uint32_t low = 0;
+        uint32_t high = size;
+
+        while (low < high) {
+            const uint32_t mid = low + (high - low) / 2;
+
+            if (key_at(mid) < key) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        // Duplicates are rare, so they are not searched for
+        uint32_t end = low;
+
+        while (end < size && key_at(end) == key) {
+            ++end;
+        }
+
+        return {low, end};
+    }
+
+    /**
+     * Move the view to the type of the value at pos of the key table
+     *
+     * The view has to be placed right after the entry count of the map.
+     */
+    static void move_to_sorted_value(bitstream &view, uint32_t size,
+                                     uint32_t pos) {
+        const uint8_t *table = view.current();
+        const uint32_t table_size = size * sizeof(uint32_t);
+
+        uint32_t offset, length;
+        memcpy(&offset, table + pos * sizeof(uint32_t), sizeof(offset));
+        memcpy(&length, table + table_size + offset, sizeof(length));
+
+        view.move_by(table_size + offset + sizeof(length) + length);
+    }
 };
 
 } // namespace json
@@ -0,0 +1,213 @@
+#include "IndexedParser.h"
+#include "json.h"
+
+#include <algorithm>
+
+namespace json {
+
+IndexedParser::IndexedParser(std::string_view str_, bitstream &result_,
+                             IndexKernel kernel, bool validate_utf8)
+    : Parser(str_, result_), m_index(m_own_index) {
+    m_own_index.start(str.data(), str.size(), kernel, validate_utf8);
+}
+
+IndexedParser::IndexedParser(const char *data, size_t length,
+                             bitstream &result_, IndexKernel kernel,
+                             bool validate_utf8)
+    : IndexedParser(std::string_view(data, length), result_, kernel,
+                    validate_utf8) {}
+
+IndexedParser::IndexedParser(std::string_view str_, bitstream &result_,
+                             const StructuralIndex &index)
+    : Parser(str_, result_), m_index(index) {}
+
+void IndexedParser::do_parse() {
+    if (!has_structural()) {
+        return;
+    }
+
+    parse_value("");
+}
+
+void IndexedParser::finish_input() {
+    if (has_structural()) {
+        throw json_parse_error(ParseErrorCode::TrailingInput,
+                               "Unexpected input after the value",
+                               m_index[m_next]);
+    }
+}
+
+void IndexedParser::reset(std::string_view str_, bitstream &result_,
+                          IndexKernel kernel, bool validate_utf8) {
+    if (&m_index != &m_own_index) {
+        throw json_error("Cannot reset a parser with an external index");
+    }
+
+    Parser::reset(str_, result_);
+    m_next = 0;
+
+    m_own_index.start(str.data(), str.size(), kernel, validate_utf8);
+}
+
+size_t IndexedParser::position() const {
+    size_t pos = Parser::position();
+
+    if (m_next > 0 && m_next <= m_index.size()) {
+        pos = std::max<size_t>(pos, m_index[m_next - 1]);
+    }
+
+    return pos;
+}
+
+void IndexedParser::parse_elements(size_t begin, size_t end) {
+    m_next = begin;
+    writer.start_array("");
+
+    while (true) {
+        // Writer ignores keys inside of arrays
+        parse_value("");
+
+        if (m_next == end) {
+            break;
+        }
+
+        if (m_next > end ||
+            str[next_structural("Array not terminated!")] != ',') {
+            throw json_parse_error(ParseErrorCode::InvalidArray,
+                                   "Not a valid array");
+        }
+    }
+
+    writer.end_array();
+}
+
+bool IndexedParser::index_more() {
+    // Windows can lie within a single string and add nothing
+    while (&m_index == &m_own_index && m_own_index.index_more()) {
+        if (m_next < m_index.size()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t IndexedParser::next_structural(const char *error) {
+    if (!has_structural()) {
+        throw json_parse_error(ParseErrorCode::UnexpectedEnd, error);
+    }
+
+    return m_index[m_next++];
+}
+
+char IndexedParser::peek_structural() {
+    if (!has_structural()) {
+        return '\0';
+    }
+
+    return str[m_index[m_next]];
+}
+
+void IndexedParser::finish_scalar() {
+    auto end = str.end();
+
+    if (has_structural()) {
+        end = str.begin() + m_index[m_next];
+    }
+
+    while (it < end &&
+           (*it == ' ' || *it == '\n' || *it == '\t' || *it == '\r')) {
+        ++it;
+    }
+
+    if (it != end) {
+        throw json_parse_error(ParseErrorCode::InvalidValue,
+                               "Invalid JSON value");
+    }
+}
+
+void IndexedParser::parse_value(std::string_view key) {
+    it = str.begin() + next_structural("Invalid JSON value");
+
+    switch (*it) {
+    case '{':
+        parse_indexed_map(key);
+        break;
+    case '[':
+        parse_indexed_array(key);
+        break;
+    case '}':
+    case ']':
+    case ':':
+    case ',':
+        throw json_parse_error(ParseErrorCode::InvalidValue,
+                               "Invalid JSON value");
+    default:
+        Parser::parse(key);
+        finish_scalar();
+        break;
+    }
+}
+
+void IndexedParser::parse_indexed_map(std::string_view key) {
+    writer.start_map(key);
+
+    if (peek_structural() == '}') {
+        ++m_next;
+        writer.end_map();
+        return;
+    }
+
+    while (true) {
+        it = str.begin() + next_structural("Map not terminated!");
+
+        auto child_key = read_key();
+        finish_scalar();
+
+        if (str[next_structural("Map not terminated!")] != ':') {
+            throw json_parse_error(ParseErrorCode::InvalidMap,
+                                   "Not a valid map");
+        }
+
+        parse_value(child_key);
+
+        auto c = str[next_structural("Map not terminated!")];
+
+        if (c == '}') {
+            break;
+        } else if (c != ',') {
+            throw json_parse_error(ParseErrorCode::InvalidMap,
+                                   "Not a valid map");
+        }
+    }
+
+    writer.end_map();
+}
+
+void IndexedParser::parse_indexed_array(std::string_view key) {
+    writer.start_array(key);
+
+    if (peek_structural() == ']') {
+        ++m_next;
+        writer.end_array();
+        return;
+    }
+
+    while (true) {
+        // Writer ignores keys inside of arrays
+        parse_value("");
+
+        auto c = str[next_structural("Array not terminated!")];
+
+        if (c == ']') {
+            break;
+        } else if (c != ',') {
+            throw json_parse_error(ParseErrorCode::InvalidArray,
+                                   "Not a valid array");
+        }
+    }
+
+    writer.end_array();
+}
+
+} // namespace json
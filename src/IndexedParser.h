@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Parser.h"
+#include "StructuralIndex.h"
+
+namespace json {
+
+/**
+ * Two-stage JSON parser
+ *
+ * Builds a StructuralIndex of the input and walks it to drive the Writer, so
+ * whitespace and string contents are never looked at byte by byte. Scalar
+ * values are decoded by the Parser base class, which also serves as the
+ * reference implementation.
+ *
+ * An index the parser owns is built one window at a time, whenever parsing
+ * reaches its end. Malformed input is thus rejected after looking at little
+ * more than the part before the error, and do_parse() does not look at input
+ * after the value at all.
+ */
+class IndexedParser : public Parser {
+  public:
+    /**
+     * \param validate_utf8
+     *      Reject input that is not valid UTF-8 (see StructuralIndex::build)
+     */
+    IndexedParser(std::string_view str_, bitstream &result_,
+                  IndexKernel kernel = IndexKernel::Best,
+                  bool validate_utf8 = false);
+    IndexedParser(const char *data, size_t length, bitstream &result_,
+                  IndexKernel kernel = IndexKernel::Best,
+                  bool validate_utf8 = false);
+
+    /**
+     * Use an index that has already been built for the input
+     *
+     * The index is not copied and must outlive the parser.
+     */
+    IndexedParser(std::string_view str_, bitstream &result_,
+                  const StructuralIndex &index);
+
+    void do_parse();
+
+    /**
+     * Parse a new input into result with this parser
+     *
+     * The structural index is rebuilt in place, so its memory is reused.
+     *
+     * \throws json_error if the parser uses an index it does not own
+     */
+    void reset(std::string_view str_, bitstream &result_,
+               IndexKernel kernel = IndexKernel::Best,
+               bool validate_utf8 = false);
+
+    /**
+     * How far the parser has read into the input, as a byte offset
+     *
+     * This is the start of the last value or structural character that was
+     * looked at.
+     */
+    size_t position() const;
+
+    /**
+     * Parse a range of elements of the top-level array into a new array
+     *
+     * \param begin
+     *      Index of the first structural of the first element
+     * \param end
+     *      Index of the comma or bracket that follows the last element
+     * \throws json_error if the elements do not end exactly at end
+     */
+    void parse_elements(size_t begin, size_t end);
+
+    /**
+     * Make sure the value that was parsed is followed by nothing else
+     *
+     * do_parse() ignores anything after the first value. This indexes the
+     * rest of the input, so it also checks that it is valid UTF-8 if asked
+     * to.
+     *
+     * \throws json_parse_error at the start of the remaining input
+     */
+    void finish_input();
+
+  protected:
+    void parse_value(std::string_view key);
+    void parse_indexed_map(std::string_view key);
+    void parse_indexed_array(std::string_view key);
+
+    /**
+     * Whether there is a structural at m_next, indexing more input if needed
+     */
+    bool has_structural() { return m_next < m_index.size() || index_more(); }
+
+    /**
+     * Move to the next structural character and return its position
+     *
+     * \throws json_error with the given message if there is none
+     */
+    uint32_t next_structural(const char *error);
+
+    /**
+     * Get the next structural character without moving to it (or '\0')
+     */
+    char peek_structural();
+
+    /**
+     * Make sure a scalar is followed by nothing but whitespace
+     */
+    void finish_scalar();
+
+    /**
+     * Index windows of the input until one adds a structural
+     *
+     * \returns false if the index is not owned or complete
+     */
+    bool index_more();
+
+    StructuralIndex m_own_index;
+    const StructuralIndex &m_index;
+    size_t m_next = 0;
+};
+
+} // namespace json
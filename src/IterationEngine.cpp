@@ -1,4 +1,7 @@
 #include "Iterator.h"
+#include "Datetime.h"
+#include "DocumentTraversal.h"
+#include "TypedArray.h"
 #include "json.h"
 #include "json/json_error.h"
 
@@ -8,6 +11,11 @@ using std::to_string;
 
 namespace json {
 
+void Iterator::handle_timestamp(const std::string &key,
+                                const timestamp_t &value) {
+    handle_datetime(key, to_tm(value));
+}
+
 IterationEngine::IterationEngine(const bitstream &data,
                                  json::Iterator &iterator_)
     : iterator(iterator_) {
@@ -49,6 +57,12 @@ void IterationEngine::parse_next(const std::string &key) {
         iterator.handle_datetime(key, val);
         break;
     }
+    case ObjectType::Timestamp: {
+        timestamp_t val;
+        view >> val.micros >> val.utc_offset;
+        iterator.handle_timestamp(key, val);
+        break;
+    }
     case ObjectType::Binary: {
         uint32_t size = 0;
         uint8_t *data = nullptr;
@@ -57,14 +71,27 @@ void IterationEngine::parse_next(const std::string &key) {
         iterator.handle_binary(key, data, size);
         break;
     }
-    case ObjectType::Map: {
-        handle_map(key);
+    case ObjectType::KeyDictionary: {
+        const auto outer = keys;
+        keys.load(view);
+        parse_next(key);
+        keys = outer;
+        break;
+    }
+    case ObjectType::Map:
+    case ObjectType::SortedMap:
+    case ObjectType::DictionaryMap: {
+        handle_map(key, type);
         break;
     }
     case ObjectType::Array: {
         handle_array(key);
         break;
     }
+    case ObjectType::TypedArray: {
+        handle_typed_array(key);
+        break;
+    }
     case ObjectType::True: {
         iterator.handle_boolean(key, true);
         break;
@@ -83,7 +110,7 @@ void IterationEngine::parse_next(const std::string &key) {
     }
 }
 
-void IterationEngine::handle_map(const std::string &key) {
+void IterationEngine::handle_map(const std::string &key, ObjectType type) {
     iterator.handle_map_start(key);
 
     uint32_t byte_size = 0;
@@ -92,9 +119,10 @@ void IterationEngine::handle_map(const std::string &key) {
     uint32_t size = 0;
     view >> size;
 
+    DocumentTraversal::skip_key_table(type, size, view);
+
     for (uint32_t i = 0; i < size; ++i) {
-        std::string key;
-        view >> key;
+        const std::string key(keys.read_key(type, view));
         parse_next(key);
     }
 
@@ -114,4 +142,26 @@ void IterationEngine::handle_array(const std::string &key) {
     iterator.handle_array_end();
 }
 
+void IterationEngine::handle_typed_array(const std::string &key) {
+    iterator.handle_array_start(key);
+
+    ObjectType element_type;
+    uint32_t size = 0;
+    read_typed_array(view, element_type, size);
+
+    for (uint32_t i = 0; i < size; ++i) {
+        if (element_type == ObjectType::Integer) {
+            integer_t value;
+            view >> value;
+            iterator.handle_integer(to_string(i), value);
+        } else {
+            json::float_t value;
+            view >> value;
+            iterator.handle_float(to_string(i), value);
+        }
+    }
+
+    iterator.handle_array_end();
+}
+
 } // namespace json
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "KeyDictionary.h"
 #include "json/json.h"
 
 namespace json {
@@ -16,8 +17,12 @@ class IterationEngine {
     bitstream view;
     Iterator &iterator;
 
-    void handle_map(const std::string &key);
+    /// The dictionary of the value that is currently visited, if any
+    KeyDictionary keys;
+
+    void handle_map(const std::string &key, ObjectType type);
     void handle_array(const std::string &key);
+    void handle_typed_array(const std::string &key);
 };
 
 class Printer : public Iterator {
@@ -35,6 +40,8 @@ class Printer : public Iterator {
     void handle_boolean(const std::string &key, const bool value) override;
     void handle_null(const std::string &key) override;
     void handle_datetime(const std::string &key, const tm &value) override;
+    void handle_timestamp(const std::string &key,
+                          const timestamp_t &value) override;
     void handle_map_end() override;
     void handle_array_start(const std::string &key) override;
     void handle_array_end() override;
@@ -67,6 +74,8 @@ class DocumentPrettyPrinter : public json::Iterator {
     void handle_binary(const std::string &key, const uint8_t *data,
                        uint32_t size) override;
     void handle_datetime(const std::string &key, const tm &value) override;
+    void handle_timestamp(const std::string &key,
+                          const timestamp_t &value) override;
 
     const std::string &get_result() const { return m_res; }
 
@@ -0,0 +1,83 @@
+#include "KeyDictionary.h"
+#include "json/json_error.h"
+
+#include <cstring>
+
+namespace json {
+
+void KeyDictionary::load(bitstream &view) {
+    uint32_t byte_size = 0;
+    view >> byte_size;
+
+    m_table = view.current();
+    view >> m_size;
+
+    const uint8_t *keys = m_table + sizeof(m_size) + m_size * sizeof(uint32_t);
+    m_table_size = keys - m_table;
+
+    // The keys end where the last one does
+    if (m_size > 0) {
+        uint32_t offset, length;
+        memcpy(&offset, keys - sizeof(uint32_t), sizeof(offset));
+        memcpy(&length, keys + offset, sizeof(length));
+
+        m_table_size += offset + sizeof(length) + length;
+    }
+
+    m_table_size += dictionary_padding(m_table_size);
+
+    view.move_by(m_table_size - sizeof(m_size));
+}
+
+std::string_view KeyDictionary::operator[](key_id_t id) const {
+    if (id >= m_size) {
+        throw json_error("Key is not in the dictionary");
+    }
+
+    const uint8_t *keys = m_table + sizeof(m_size) + m_size * sizeof(uint32_t);
+
+    uint32_t offset, length;
+    memcpy(&offset, m_table + sizeof(m_size) + id * sizeof(uint32_t),
+           sizeof(offset));
+    memcpy(&length, keys + offset, sizeof(length));
+
+    return std::string_view(
+        reinterpret_cast<const char *>(keys + offset + sizeof(length)), length);
+}
+
+key_id_t KeyDictionary::find(std::string_view key) const {
+    for (uint32_t id = 0; id < m_size; ++id) {
+        if ((*this)[id] == key) {
+            return id;
+        }
+    }
+
+    return NO_KEY;
+}
+
+std::string_view KeyDictionary::read_key(ObjectType map_type,
+                                         bitstream &view) const {
+    if (map_type == ObjectType::DictionaryMap) {
+        key_id_t id;
+        view >> id;
+        return (*this)[id];
+    }
+
+    uint32_t length;
+    view >> length;
+
+    const auto *data = reinterpret_cast<const char *>(view.current());
+    view.move_by(length);
+
+    return std::string_view(data, length);
+}
+
+void KeyDictionary::wrap(const uint8_t *value, uint32_t size,
+                         bitstream &result) const {
+    result << ObjectType::KeyDictionary
+           << static_cast<uint32_t>(m_table_size + size);
+    result.write_raw_data(m_table, m_table_size);
+    result.write_raw_data(value, size);
+}
+
+} // namespace json
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <bitstream.h>
+
+#include "json/defines.h"
+
+#include <string_view>
+
+namespace json {
+
+/// Id of a key that is not in the dictionary
+constexpr key_id_t NO_KEY = UINT16_MAX;
+
+/// Ids are assigned from zero, and NO_KEY is never used
+constexpr uint32_t MAX_DICTIONARY_KEYS = NO_KEY;
+
+/**
+ * Zero bytes after the keys of a dictionary of this size
+ *
+ * Dictionaries take a multiple of eight bytes, so that putting one in front
+ * of a value keeps the values of its typed arrays aligned.
+ */
+inline uint32_t dictionary_padding(uint32_t table_size) {
+    const uint32_t size = sizeof(ObjectType) + sizeof(uint32_t) + table_size;
+    return (8 - size % 8) % 8;
+}
+
+/**
+ * The keys of an ObjectType::KeyDictionary
+ *
+ * Refers to the encoded dictionary instead of copying it, so loading one does
+ * not allocate. It is only valid as long as the document it was loaded from.
+ */
+class KeyDictionary {
+  public:
+    /**
+     * Load the dictionary at the current position of the view
+     *
+     * The view has to be placed right after the type of the dictionary.
+     * Afterwards, it is at the type of the value that refers to it.
+     */
+    void load(bitstream &view);
+
+    bool loaded() const { return m_table != nullptr; }
+
+    uint32_t size() const { return m_size; }
+
+    /**
+     * \throws json_error if there is no key with this id
+     */
+    std::string_view operator[](key_id_t id) const;
+
+    /**
+     * \returns the id of the key or NO_KEY if the dictionary does not hold it
+     */
+    key_id_t find(std::string_view key) const;
+
+    /**
+     * Read the key of the next entry of a map
+     *
+     * Dictionary maps refer to this dictionary, all other maps hold their
+     * keys inline. The result points into the view.
+     */
+    std::string_view read_key(ObjectType map_type, bitstream &view) const;
+
+    /**
+     * Write an encoded value along with a copy of this dictionary, so that
+     * it can be read on its own
+     */
+    void wrap(const uint8_t *value, uint32_t size, bitstream &result) const;
+
+    /**
+     * Whether values of this type may refer to an enclosing dictionary
+     */
+    static bool uses_keys(ObjectType type) {
+        return type == ObjectType::DictionaryMap || type == ObjectType::Array;
+    }
+
+  private:
+    /// Starts at the number of keys
+    const uint8_t *m_table = nullptr;
+    uint32_t m_table_size = 0;
+    uint32_t m_size = 0;
+};
+
+} // namespace json
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "json/defines.h"
+
+namespace json {
+
+/**
+ * Decodes JSON numbers in a single pass
+ *
+ * Does not depend on the current locale. Integers are checked for overflow.
+ * Most floating point numbers are computed exactly with the Clinger and
+ * Eisel-Lemire fast paths; only inputs with more than 19 significant digits
+ * that cannot be rounded directly fall back to std::from_chars.
+ */
+class NumberParser {
+  public:
+    /**
+     * Decode the number that starts at begin
+     *
+     * \returns a pointer to the first character after the number
+     * \throws json_error if the input is not a valid number or an integer
+     *         does not fit into integer_t
+     */
+    const char *parse(const char *begin, const char *end);
+
+    bool is_integer() const { return m_is_integer; }
+
+    integer_t integer() const { return m_integer; }
+
+    float_t floating() const { return m_float; }
+
+  private:
+    float_t compute_float(const char *begin, const char *end, bool negative,
+                          uint64_t mantissa, int64_t exponent,
+                          bool truncated) const;
+
+    bool m_is_integer = false;
+    integer_t m_integer = 0;
+    float_t m_float = 0.0;
+};
+
+} // namespace json
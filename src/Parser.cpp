@@ -1,14 +1,37 @@
 #include "Parser.h"
+#include "Datetime.h"
+#include "NumberParser.h"
+#include "StringDecoder.h"
 #include "json.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace json {
 
-inline json_error make_parse_error(const std::string &msg,
-                                   const std::string &str,
-                                   const std::string &expected,
-                                   const std::string::const_iterator &it) {
+namespace {
+
+/// How many bytes of input to show on either side of an error
+constexpr size_t SNIPPET_RADIUS = 16;
+
+std::string_view make_snippet(std::string_view str, size_t offset) {
+    const size_t begin = offset > SNIPPET_RADIUS ? offset - SNIPPET_RADIUS : 0;
+    return str.substr(begin, offset - begin + SNIPPET_RADIUS);
+}
+
+} // namespace
+
+inline json_parse_error make_parse_error(const std::string &msg,
+                                         std::string_view str,
+                                         const std::string &expected,
+                                         std::string_view::const_iterator it) {
+    const size_t offset = it - str.begin();
+
+    // Only show the input around the error, which might be huge
     std::string out;
-    out += msg + ": <" + str + ">. ";
+    out += msg + " at offset " + std::to_string(offset) + ": <";
+    out += make_snippet(str, offset);
+    out += ">. ";
     out += "Expected \"" + expected + "\", got ";
 
     if (it == str.end()) {
@@ -19,17 +42,92 @@ inline json_error make_parse_error(const std::string &msg,
         out += '\"';
     }
 
-    return json_error(out);
+    return json_parse_error(ParseErrorCode::InvalidMap, out);
 }
 
-Parser::Parser(const std::string &str_, bitstream &result_)
+Parser::Parser(std::string_view str_, bitstream &result_)
     : str(str_), writer(result_) {
     it = str.begin();
 }
 
+Parser::Parser(const char *data, size_t length, bitstream &result_)
+    : Parser(std::string_view(data, length), result_) {}
+
 void Parser::do_parse() { parse(""); }
 
-void Parser::parse(const std::string &key) {
+const char *error_message(ParseErrorCode code) {
+    switch (code) {
+    case ParseErrorCode::None:
+        return "No error";
+    case ParseErrorCode::InvalidValue:
+        return "Invalid JSON value";
+    case ParseErrorCode::InvalidLiteral:
+        return "Invalid literal";
+    case ParseErrorCode::InvalidNumber:
+        return "Invalid number";
+    case ParseErrorCode::NumberOutOfRange:
+        return "Number is out of range";
+    case ParseErrorCode::InvalidString:
+        return "Invalid string";
+    case ParseErrorCode::InvalidEscape:
+        return "Invalid escape sequence";
+    case ParseErrorCode::InvalidDatetime:
+        return "Invalid datetime";
+    case ParseErrorCode::InvalidMap:
+        return "Invalid map";
+    case ParseErrorCode::InvalidArray:
+        return "Invalid array";
+    case ParseErrorCode::UnexpectedEnd:
+        return "Unexpected end of input";
+    case ParseErrorCode::InputTooLarge:
+        return "Input is too large";
+    case ParseErrorCode::InvalidUtf8:
+        return "Invalid UTF-8";
+    case ParseErrorCode::TrailingInput:
+        return "Unexpected input after the value";
+    }
+
+    return "Unknown error";
+}
+
+ParseError Parser::make_error(ParseErrorCode code, std::string_view str,
+                              size_t offset) {
+    ParseError error;
+    error.code = code;
+    error.offset = std::min(offset, str.size());
+    error.line = 1;
+
+    const char *pos = str.data();
+    const char *end = pos + error.offset;
+    const char *line_start = pos;
+
+    while (pos < end) {
+        const auto *newline =
+            static_cast<const char *>(memchr(pos, '\n', end - pos));
+
+        if (newline == nullptr) {
+            break;
+        }
+
+        ++error.line;
+        pos = line_start = newline + 1;
+    }
+
+    error.column = end - line_start + 1;
+    error.snippet = make_snippet(str, error.offset);
+
+    return error;
+}
+
+size_t Parser::position() const { return it - str.begin(); }
+
+void Parser::reset(std::string_view str_, bitstream &result_) {
+    str = str_;
+    it = str.begin();
+    writer.reset(result_);
+}
+
+void Parser::parse(std::string_view key) {
     skip_whitespace();
 
     if (it == str.end()) {
@@ -46,9 +144,7 @@ void Parser::parse(const std::string &key) {
     case '"':
         parse_string(key);
         break;
-    case '+':
     case '-':
-    case '.':
     case '0':
     case '1':
     case '2':
@@ -59,8 +155,6 @@ void Parser::parse(const std::string &key) {
     case '7':
     case '8':
     case '9':
-    case 'e':
-    case 'E':
         parse_number(key);
         break;
     case 't': // STR_TRUE[0]:
@@ -76,11 +170,12 @@ void Parser::parse(const std::string &key) {
         parse_datetime(key);
         break;
     default:
-        throw json_error("Invalid JSON value");
+        throw json_parse_error(ParseErrorCode::InvalidValue,
+                               "Invalid JSON value");
     }
 }
 
-bool Parser::check_string(const std::string &value) {
+bool Parser::check_string(std::string_view value) {
     size_t c = 0;
 
     while (c < value.size() && it != str.end()) {
@@ -95,77 +190,34 @@ bool Parser::check_string(const std::string &value) {
     return c == value.size();
 }
 
-void Parser::parse_datetime(const std::string &key) {
+void Parser::parse_datetime(std::string_view key) {
     if (!check_string("d\"")) {
-        throw json_error("Not a datetime structure!");
+        throw json_parse_error(ParseErrorCode::InvalidDatetime,
+                               "Not a datetime structure!");
     }
 
-    enum class parse_state { Year, Month, Day, Hour, Minute, Second, Done };
-
-    auto state = parse_state::Year;
-    std::string temp;
+    const char *begin = str.data() + (it - str.begin());
 
-    tm val;
-    memset(&val, 0, sizeof(val));
+    timestamp_t val;
+    const char *end = read_datetime(begin, str.data() + str.size(), val);
 
-    for (; it != str.end() && state != parse_state::Done; ++it) {
-        if (isspace(*it) != 0 || *it == '-' || *it == ':' || *it == '"') {
-            if (temp.empty()) {
-                continue;
-            }
-
-            const char *start = &temp[0];
-            char *end = nullptr;
-            auto i = std::strtol(start, &end, 10);
-
-            switch (state) {
-            case parse_state::Year:
-                state = parse_state::Month;
-                val.tm_year = i;
-                break;
-            case parse_state::Month:
-                state = parse_state::Day;
-                val.tm_mon = i;
-                break;
-            case parse_state::Day:
-                state = parse_state::Hour;
-                val.tm_mday = i;
-                break;
-            case parse_state::Hour:
-                state = parse_state::Minute;
-                val.tm_hour = i;
-                break;
-            case parse_state::Minute:
-                state = parse_state::Second;
-                val.tm_min = i;
-                break;
-            case parse_state::Second:
-                state = parse_state::Done;
-                val.tm_sec = i;
-                break;
-            default:
-                throw json_error("unknown datetime parse state");
-                break;
-            }
+    it += end - begin;
+    writer.write_timestamp(key, val);
+}
 
-            temp = "";
-        } else {
-            temp += *it;
-        }
-    }
+const char *Parser::read_datetime(const char *pos, const char *end,
+                                  timestamp_t &value) {
+    pos = read_iso8601(pos, end, value);
 
-    if (state != parse_state::Done) {
-        throw json_error("Failed to parse datetime");
+    if (pos == end || *pos != '"') {
+        throw json_parse_error(ParseErrorCode::InvalidDatetime,
+                               "Failed to parse datetime");
     }
 
-    // TODO check/support for other formats
-    // auto res = strptime(str.c_str(), "%Y-%m-%d %T", &val);
-    // time_t since_epoch = timegm(&val);
-
-    writer.write_datetime(key, val);
+    return pos + 1;
 }
 
-void Parser::parse_map(const std::string &key) {
+void Parser::parse_map(std::string_view key) {
     if (it == str.end() || *it != '{') {
         throw make_parse_error("Not a valid map", str, "{", it);
     }
@@ -190,7 +242,7 @@ void Parser::parse_map(const std::string &key) {
             skip_whitespace();
         }
 
-        std::string child_key = read_string();
+        auto child_key = read_key();
 
         skip_whitespace();
 
@@ -206,8 +258,9 @@ void Parser::parse_map(const std::string &key) {
         skip_whitespace();
     }
 
-    if (*it != '}') {
-        throw json_error("Map not terminated!");
+    if (it == str.end() || *it != '}') {
+        throw json_parse_error(ParseErrorCode::UnexpectedEnd,
+                               "Map not terminated!");
     }
 
     ++it;
@@ -215,69 +268,52 @@ void Parser::parse_map(const std::string &key) {
     writer.end_map();
 }
 
-void Parser::parse_number(const std::string &key) {
-    bool is_double = false;
-
-    std::string::const_iterator it2 = it;
-
-    while (it2 != str.end()) {
-        if (!(isdigit(*it2) != 0 || *it2 == '+' || *it2 == '-' || *it2 == '.' ||
-              *it2 == 'e' || *it2 == 'E')) {
-            break;
-        }
-
-        if (*it2 == '.' || *it2 == 'e' || *it2 == 'E') {
-            is_double = true;
-        }
-
-        ++it2;
-    }
+void Parser::parse_number(std::string_view key) {
+    const char *start = str.data() + (it - str.begin());
 
-    const char *start = it.base();
-    char *end = nullptr;
+    NumberParser number;
+    const char *end = number.parse(start, str.data() + str.size());
 
-    if (is_double) {
-        json::float_t val = std::strtod(start, &end);
-        writer.write_float(key, val);
+    if (number.is_integer()) {
+        writer.write_integer(key, number.integer());
     } else {
-        integer_t val = std::strtol(start, &end, 10);
-        writer.write_integer(key, val);
+        writer.write_float(key, number.floating());
     }
 
-    size_t diff = end - start;
-
-    for (size_t i = 0; i < diff; ++i) {
-        ++it;
-    }
+    it += end - start;
 }
 
-void Parser::parse_true(const std::string &key) {
+void Parser::parse_true(std::string_view key) {
     if (!check_string(keyword(TRUE))) {
-        throw json_error("Not a valid boolean");
+        throw json_parse_error(ParseErrorCode::InvalidLiteral,
+                               "Not a valid boolean");
     }
 
     writer.write_boolean(key, true);
 }
 
-void Parser::parse_false(const std::string &key) {
+void Parser::parse_false(std::string_view key) {
     if (!check_string(keyword(FALSE))) {
-        throw json_error("Not a valid boolean");
+        throw json_parse_error(ParseErrorCode::InvalidLiteral,
+                               "Not a valid boolean");
     }
 
     writer.write_boolean(key, false);
 }
 
-void Parser::parse_null(const std::string &key) {
+void Parser::parse_null(std::string_view key) {
     if (!check_string(keyword(NIL))) {
-        throw json_error("Not a valid null value");
+        throw json_parse_error(ParseErrorCode::InvalidLiteral,
+                               "Not a valid null value");
     }
 
     writer.write_null(key);
 }
 
-void Parser::parse_array(const std::string &key) {
+void Parser::parse_array(std::string_view key) {
     if (it == str.end() || *it != '[') {
-        throw json_error("Not a valid array!");
+        throw json_parse_error(ParseErrorCode::InvalidArray,
+                               "Not a valid array!");
     }
 
     ++it;
@@ -285,8 +321,6 @@ void Parser::parse_array(const std::string &key) {
     writer.start_array(key);
     bool first = true;
 
-    uint32_t pos = 0;
-
     while (it != str.end() && *it != ']') {
         skip_whitespace();
 
@@ -294,53 +328,50 @@ void Parser::parse_array(const std::string &key) {
             first = false;
         } else {
             if (it == str.end() || *it != ',') {
-                throw json_error("Not a valid array");
+                throw json_parse_error(ParseErrorCode::InvalidArray,
+                                       "Not a valid array");
             }
 
             ++it;
             skip_whitespace();
         }
 
-        parse(std::to_string(pos));
-        pos++;
+        // Writer ignores keys inside of arrays
+        parse("");
 
         skip_whitespace();
     }
 
     skip_whitespace();
 
-    if (*it != ']') {
-        throw json_error("Array not terminated!");
+    if (it == str.end() || *it != ']') {
+        throw json_parse_error(ParseErrorCode::UnexpectedEnd,
+                               "Array not terminated!");
     }
 
     ++it;
     writer.end_array();
 }
 
-void Parser::parse_string(const std::string &key) {
-    auto str = read_string();
-    writer.write_string(key, str);
+void Parser::parse_string(std::string_view key) {
+    writer.write_string(key, read_string());
 }
 
-std::string Parser::read_string() {
-    if (it == str.end() || *it != '"') {
-        throw json_error("Not a valid string");
-    }
+std::string_view Parser::read_string() { return decode_string(strings); }
 
-    ++it;
-    std::string result;
+std::string_view Parser::read_key() { return decode_string(keys); }
 
-    while (it != str.end() && *it != '"') {
-        result += *it;
-        ++it;
+std::string_view Parser::decode_string(StringDecoder &decoder) {
+    if (it == str.end() || *it != '"') {
+        throw json_parse_error(ParseErrorCode::InvalidString,
+                               "Not a valid string");
     }
 
-    if (it == str.end()) {
-        throw json_error("String not terminated!");
-    }
+    const char *begin = str.data() + (it - str.begin()) + 1;
+    const char *end = decoder.decode(begin, str.data() + str.size());
 
-    ++it;
-    return result;
+    it += end - begin + 1;
+    return decoder.value();
 }
 
 } // namespace json
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "StringDecoder.h"
 #include "json/json.h"
 
+#include <string_view>
+
 namespace json {
 
 /**
@@ -9,36 +12,88 @@ namespace json {
  */
 class Parser {
   public:
-    Parser(const std::string &str_, bitstream &result_);
+    /**
+     * The input is not copied and does not need to be null-terminated
+     */
+    Parser(std::string_view str_, bitstream &result_);
+    Parser(const char *data, size_t length, bitstream &result_);
 
     void do_parse();
 
-  private:
-    void parse(const std::string &key);
+    /**
+     * Parse a new input into result with this parser
+     *
+     * Memory of the writer and string decoders is reused.
+     */
+    void reset(std::string_view str_, bitstream &result_);
+
+    /**
+     * How far the parser has read into the input, as a byte offset
+     */
+    size_t position() const;
+
+    /**
+     * Describe a parse error at the given byte offset of str
+     *
+     * Only the input before the error and a few bytes after it are read.
+     */
+    static ParseError make_error(ParseErrorCode code, std::string_view str,
+                                 size_t offset);
+
+    /**
+     * Decode the body of a datetime, i.e. everything after d"
+     *
+     * \returns a pointer to the first character after the closing quote
+     * \throws json_error if the datetime is not valid
+     */
+    static const char *read_datetime(const char *pos, const char *end,
+                                     timestamp_t &value);
+
+  protected:
+    void parse(std::string_view key);
 
     void skip_whitespace();
 
-    void parse_array(const std::string &key);
-    void parse_null(const std::string &key);
-    void parse_string(const std::string &key);
-    void parse_number(const std::string &key);
-    void parse_map(const std::string &key);
-    void parse_true(const std::string &key);
-    void parse_false(const std::string &key);
-    void parse_datetime(const std::string &key);
+    void parse_array(std::string_view key);
+    void parse_null(std::string_view key);
+    void parse_string(std::string_view key);
+    void parse_number(std::string_view key);
+    void parse_map(std::string_view key);
+    void parse_true(std::string_view key);
+    void parse_false(std::string_view key);
+    void parse_datetime(std::string_view key);
+
+    /**
+     * Read a string and decode its escape sequences
+     *
+     * The result is only valid until the next call to read_string()
+     */
+    std::string_view read_string();
 
-    std::string read_string();
+    /**
+     * Read the key of a map entry
+     *
+     * Keys are decoded into their own buffer, so the result stays valid while
+     * the corresponding value is parsed
+     */
+    std::string_view read_key();
 
-    bool check_string(const std::string &value);
+    bool check_string(std::string_view value);
 
-    const std::string &str;
-    std::string::const_iterator it;
+    std::string_view str;
+    std::string_view::const_iterator it;
 
     Writer writer;
+    StringDecoder strings;
+    StringDecoder keys;
+
+  private:
+    std::string_view decode_string(StringDecoder &decoder);
 };
 
 inline void Parser::skip_whitespace() {
-    while (*it == ' ' || *it == '\n' || *it == '\t') {
+    while (it != str.end() &&
+           (*it == ' ' || *it == '\n' || *it == '\t' || *it == '\r')) {
         ++it;
     }
 }
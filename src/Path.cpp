@@ -0,0 +1,82 @@
+#include "json/Path.h"
+#include "json.h"
+#include "json/json_error.h"
+
+#include <charconv>
+
+namespace json {
+
+Path::Path(std::string_view path) : m_path(path) {
+    if (path.empty()) {
+        return;
+    }
+
+    size_t begin = 0;
+
+    while (true) {
+        const size_t end = std::min(path.find('.', begin), path.size());
+        const auto key = path.substr(begin, end - begin);
+
+        if (key.empty()) {
+            throw json_error("Path holds an empty key");
+        } else if (key == keyword(WILDCARD)) {
+            throw json_error("Compiled paths cannot hold wildcards");
+        }
+
+        Segment segment = {static_cast<uint32_t>(begin),
+                           static_cast<uint32_t>(key.size()), 0, false};
+
+        // Arrays are searched by the string of their positions, so there is
+        // exactly one key for each index
+        if (key.size() == 1 || key[0] != '0') {
+            const char *key_end = key.data() + key.size();
+            auto res = std::from_chars(key.data(), key_end, segment.index);
+            segment.is_index = res.ec == std::errc() && res.ptr == key_end;
+        }
+
+        m_segments.push_back(segment);
+
+        if (end == path.size()) {
+            break;
+        }
+
+        begin = end + 1;
+    }
+}
+
+PathSet::PathSet(const std::vector<std::string> &paths)
+    : m_nodes(1), m_size(paths.size()) {
+    for (uint32_t target = 0; target < paths.size(); ++target) {
+        const Path path(paths[target]);
+        uint32_t current = 0;
+
+        for (size_t depth = 0; depth < path.size(); ++depth) {
+            const auto key = path.key(depth);
+            uint32_t next = 0;
+
+            for (auto child : m_nodes[current].children) {
+                if (m_nodes[child].key == key) {
+                    next = child;
+                    break;
+                }
+            }
+
+            if (next == 0) {
+                next = m_nodes.size();
+                m_nodes[current].children.push_back(next);
+
+                Node node;
+                node.key = key;
+                node.index = path.index(depth);
+                node.is_index = path.is_index(depth);
+                m_nodes.push_back(std::move(node));
+            }
+
+            current = next;
+        }
+
+        m_nodes[current].targets.push_back(target);
+    }
+}
+
+} // namespace json
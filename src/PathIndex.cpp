@@ -0,0 +1,180 @@
+#include "PathIndex.h"
+#include "DocumentTraversal.h"
+#include "TypedArray.h"
+
+#include <functional>
+
+namespace json {
+
+namespace {
+
+inline uint64_t hash_path(std::string_view path) {
+    return std::hash<std::string_view>()(path);
+}
+
+} // namespace
+
+PathIndex::PathIndex(const bitstream &content) {
+    bitstream view;
+    view.assign(content.data(), content.size(), true);
+
+    std::vector<Slot> entries;
+    std::string path;
+    add_children(view, path, 0, KeyDictionary(), entries);
+
+    // At most three quarters of the slots are used, so that probes stay short
+    size_t capacity = 8;
+
+    while (capacity * 3 < entries.size() * 4) {
+        capacity *= 2;
+    }
+
+    m_slots.resize(capacity, Slot{0, 0, 0, 0, 0, ObjectType::Null});
+
+    for (auto &entry : entries) {
+        const std::string_view entry_path(m_paths.data() + entry.path_offset,
+                                          entry.path_length);
+        // Entries are in document order, so the last of several equal
+        // paths wins, like with Search
+        m_slots[probe(entry.hash, entry_path)] = entry;
+    }
+}
+
+void PathIndex::add_children(bitstream &view, std::string &path,
+                             uint32_t dictionary, KeyDictionary keys,
+                             std::vector<Slot> &entries) {
+    ObjectType type;
+    view >> type;
+
+    while (type == ObjectType::KeyDictionary) {
+        dictionary = view.pos();
+        keys.load(view);
+        view >> type;
+    }
+
+    const size_t length = path.size();
+    const size_t key_start = length == 0 ? 0 : length + 1;
+
+    switch (type) {
+    case ObjectType::Map:
+    case ObjectType::SortedMap:
+    case ObjectType::DictionaryMap:
+    case ObjectType::Array: {
+        uint32_t byte_size, size;
+        view >> byte_size >> size;
+        DocumentTraversal::skip_key_table(type, size, view);
+
+        for (uint32_t i = 0; i < size; ++i) {
+            path.resize(key_start, '.');
+
+            if (type == ObjectType::Array) {
+                path += to_string(i);
+            } else {
+                path += keys.read_key(type, view);
+            }
+
+            add(path, view.pos(), dictionary, ObjectType::Null, entries);
+            add_children(view, path, dictionary, keys, entries);
+        }
+
+        path.resize(length);
+        break;
+    }
+    case ObjectType::TypedArray: {
+        ObjectType element_type;
+        uint32_t size;
+        read_typed_array(view, element_type, size);
+
+        for (uint32_t i = 0; i < size; ++i) {
+            path.resize(key_start, '.');
+            path += to_string(i);
+
+            add(path, view.pos(), 0, element_type, entries);
+            view.move_by(TYPED_ARRAY_ELEMENT_SIZE);
+        }
+
+        path.resize(length);
+        break;
+    }
+    default:
+        DocumentTraversal::skip_next(type, view);
+        break;
+    }
+}
+
+void PathIndex::add(const std::string &path, uint32_t value_offset,
+                    uint32_t dictionary, ObjectType element_type,
+                    std::vector<Slot> &entries) {
+    entries.push_back(Slot{hash_path(path),
+                           static_cast<uint32_t>(m_paths.size()),
+                           static_cast<uint32_t>(path.size()), value_offset,
+                           dictionary, element_type});
+    m_paths += path;
+}
+
+size_t PathIndex::probe(uint64_t hash, std::string_view path) const {
+    const size_t mask = m_slots.size() - 1;
+
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        const auto &slot = m_slots[pos];
+
+        if (slot.value_offset == 0 ||
+            (slot.hash == hash &&
+             std::string_view(m_paths.data() + slot.path_offset,
+                              slot.path_length) == path)) {
+            return pos;
+        }
+    }
+}
+
+bool PathIndex::find(std::string_view path, const bitstream &content,
+                     bitstream &result) const {
+    const auto &slot = m_slots[probe(hash_path(path), path)];
+
+    if (slot.value_offset == 0) {
+        return false;
+    }
+
+    if (slot.element_type != ObjectType::Null) {
+        // Elements do not have a type, so the result has to be a copy
+        result = bitstream();
+        result << slot.element_type;
+        result.write_raw_data(content.data() + slot.value_offset,
+                              TYPED_ARRAY_ELEMENT_SIZE);
+        result.move_to(0);
+        return true;
+    }
+
+    bitstream view;
+    view.assign(content.data(), content.size(), true);
+    view.move_to(slot.value_offset);
+
+    ObjectType type;
+    view >> type;
+    DocumentTraversal::skip_next(type, view);
+
+    const uint8_t *value = content.data() + slot.value_offset;
+    const uint32_t size = view.pos() - slot.value_offset;
+
+    if (slot.dictionary > 0 && KeyDictionary::uses_keys(type)) {
+        // The result has to be readable without the rest of the document
+        KeyDictionary keys;
+        view.move_to(slot.dictionary);
+        keys.load(view);
+
+        result = bitstream();
+        keys.wrap(value, size, result);
+        result.move_to(0);
+    } else {
+        result.assign(value, size, true);
+    }
+
+    return true;
+}
+
+size_t PathIndex::memory_usage() const {
+    return sizeof(*this) + m_paths.capacity() +
+           m_slots.capacity() * sizeof(Slot);
+}
+
+} // namespace json
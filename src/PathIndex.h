@@ -0,0 +1,81 @@
+#pragma once
+
+#include <bitstream.h>
+
+#include "KeyDictionary.h"
+#include "json/defines.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json {
+
+/**
+ * The positions of all values of a document by their path
+ *
+ * Paths are written like for Search, e.g. "a.b.0", and found with a single
+ * probe of a hash table. The document itself is the only value that is not
+ * indexed. If a map holds the same key more than once, the last entry with
+ * the path is used, as with Search.
+ */
+class PathIndex {
+  public:
+    explicit PathIndex(const bitstream &content);
+
+    /**
+     * Get a view of the value at the path
+     *
+     * Like Search, values that refer to a key dictionary and elements of
+     * typed arrays are copied.
+     *
+     * \returns false if there is no such value
+     */
+    bool find(std::string_view path, const bitstream &content,
+              bitstream &result) const;
+
+    /**
+     * Bytes that are held by the index
+     */
+    size_t memory_usage() const;
+
+  private:
+    struct Slot {
+        uint64_t hash;
+        uint32_t path_offset;
+        uint32_t path_length;
+
+        /// Where the value starts, which is zero for empty slots
+        uint32_t value_offset;
+
+        /// Where the key dictionary of the value starts, or zero
+        uint32_t dictionary;
+
+        /// Only set for elements of typed arrays
+        ObjectType element_type;
+    };
+
+    /**
+     * Index the children of the value at the current position
+     */
+    void add_children(bitstream &view, std::string &path, uint32_t dictionary,
+                      KeyDictionary keys, std::vector<Slot> &entries);
+
+    void add(const std::string &path, uint32_t value_offset,
+             uint32_t dictionary, ObjectType element_type,
+             std::vector<Slot> &entries);
+
+    /**
+     * The position of the slot that holds the path, or of the empty slot it
+     * would go into
+     */
+    size_t probe(uint64_t hash, std::string_view path) const;
+
+    /// All paths, one after another
+    std::string m_paths;
+
+    /// Open addressing with linear probing, the size is a power of two
+    std::vector<Slot> m_slots;
+};
+
+} // namespace json
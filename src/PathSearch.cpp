@@ -0,0 +1,396 @@
+#include "PathSearch.h"
+#include "TypedArray.h"
+
+namespace json {
+
+PathSearch::PathSearch(const Document &document, const Path &path)
+    : m_document(document), m_path(path) {
+    m_view.assign(m_document.data().data(), m_document.data().size(), true);
+}
+
+bool PathSearch::do_search() {
+    if (m_document.empty()) {
+        return false;
+    }
+
+    return search(0);
+}
+
+bool PathSearch::search(size_t depth) {
+    while (true) {
+        const uint32_t start = m_view.pos();
+
+        ObjectType type;
+        m_view >> type;
+
+        if (depth == m_path.size()) {
+            set_result(start, type);
+            return true;
+        }
+
+        switch (type) {
+        case ObjectType::KeyDictionary:
+            // The value inside is at the same path
+            m_keys.load(m_view);
+            continue;
+        case ObjectType::Map:
+        case ObjectType::SortedMap:
+        case ObjectType::DictionaryMap:
+            return search_map(type, depth);
+        case ObjectType::Array:
+            if (!m_path.is_index(depth) || !find_element(m_path.index(depth))) {
+                return false;
+            }
+            break;
+        case ObjectType::TypedArray: {
+            ObjectType element_type;
+            uint32_t size;
+            read_typed_array(m_view, element_type, size);
+
+            // Elements are scalars, so the path has to end at them
+            const uint32_t pos = m_path.index(depth);
+
+            if (depth + 1 != m_path.size() || !m_path.is_index(depth) ||
+                pos >= size) {
+                return false;
+            }
+
+            m_view.move_by(pos * TYPED_ARRAY_ELEMENT_SIZE);
+
+            // Elements do not have a type, so the result has to be a copy
+            m_result = bitstream();
+            m_result << element_type;
+            m_result.write_raw_data(m_view.current(),
+                                    TYPED_ARRAY_ELEMENT_SIZE);
+            m_result.move_to(0);
+            return true;
+        }
+        default:
+            // Scalars have no children
+            return false;
+        }
+
+        ++depth;
+    }
+}
+
+bool PathSearch::search_map(ObjectType type, size_t depth) {
+    uint32_t byte_size, size;
+    m_view >> byte_size >> size;
+
+    const auto key = m_path.key(depth);
+    const KeyDictionary keys = m_keys;
+
+    if (type == ObjectType::SortedMap) {
+        const uint32_t table = m_view.pos();
+        const auto [first, last] = find_sorted_keys(m_view, size, key);
+
+        // The last entry that has the rest of the path wins
+        for (uint32_t pos = last; pos > first; --pos) {
+            m_keys = keys;
+            m_view.move_to(table);
+            move_to_sorted_value(m_view, size, pos - 1);
+
+            if (search(depth + 1)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    key_id_t target = NO_KEY;
+
+    if (type == ObjectType::DictionaryMap) {
+        target = keys.find(key);
+
+        if (target == NO_KEY) {
+            return false;
+        }
+    }
+
+    // Like Search, every entry with the key is tried, and a later match
+    // replaces the result of an earlier one
+    bool found = false;
+
+    for (uint32_t i = 0; i < size; ++i) {
+        bool match;
+
+        if (type == ObjectType::DictionaryMap) {
+            key_id_t id;
+            m_view >> id;
+            match = id == target;
+        } else {
+            uint32_t length;
+            m_view >> length;
+
+            // Lengths are compared first, so most keys are never read
+            match = length == key.size() &&
+                    memcmp(m_view.current(), key.data(), length) == 0;
+            m_view.move_by(length);
+        }
+
+        const uint32_t value_start = m_view.pos();
+
+        if (match && search(depth + 1)) {
+            found = true;
+        }
+
+        // The value below might have a dictionary of its own
+        m_keys = keys;
+        m_view.move_to(value_start);
+
+        ObjectType child_type;
+        m_view >> child_type;
+        skip_next(child_type, m_view);
+    }
+
+    return found;
+}
+
+bool PathSearch::find_element(uint32_t pos) {
+    uint32_t byte_size, size;
+    m_view >> byte_size >> size;
+
+    if (pos >= size) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < pos; ++i) {
+        ObjectType child_type;
+        m_view >> child_type;
+        skip_next(child_type, m_view);
+    }
+
+    return true;
+}
+
+void PathSearch::set_result(uint32_t start, ObjectType type) {
+    skip_next(type, m_view);
+    const uint32_t end = m_view.pos();
+
+    if (m_keys.loaded() && KeyDictionary::uses_keys(type)) {
+        // The result has to be readable without the rest of the document
+        m_result = bitstream();
+        m_keys.wrap(&m_view.data()[start], end - start, m_result);
+        m_result.move_to(0);
+    } else {
+        m_result.assign(&m_view.data()[start], end - start, true);
+    }
+}
+
+PathSetSearch::PathSetSearch(const Document &document, const PathSet &paths)
+    : m_document(document), m_paths(paths) {
+    m_view.assign(m_document.data().data(), m_document.data().size(), true);
+}
+
+void PathSetSearch::do_search(std::vector<Document> &results) {
+    if (m_document.empty()) {
+        return;
+    }
+
+    m_results = &results;
+    visit(0, KeyDictionary());
+}
+
+void PathSetSearch::visit(uint32_t pos, KeyDictionary keys) {
+    const auto &node = m_paths.m_nodes[pos];
+    const uint32_t start = m_view.pos();
+
+    ObjectType type;
+    m_view >> type;
+
+    if (!node.targets.empty()) {
+        set_results(node, start, type, keys);
+    }
+
+    if (node.children.empty()) {
+        return;
+    }
+
+    // The value inside is at the same path
+    while (type == ObjectType::KeyDictionary) {
+        keys.load(m_view);
+        m_view >> type;
+    }
+
+    switch (type) {
+    case ObjectType::Map:
+    case ObjectType::SortedMap:
+    case ObjectType::DictionaryMap:
+        visit_map(node, type, keys);
+        break;
+    case ObjectType::Array:
+        visit_array(node, keys);
+        break;
+    case ObjectType::TypedArray:
+        visit_typed_array(node);
+        break;
+    default:
+        // Scalars have no children
+        break;
+    }
+}
+
+void PathSetSearch::set_results(const PathSet::Node &node, uint32_t start,
+                                ObjectType type, const KeyDictionary &keys) {
+    const uint32_t pos = m_view.pos();
+    skip_next(type, m_view);
+
+    const uint8_t *data = &m_view.data()[start];
+    const uint32_t size = m_view.pos() - start;
+    m_view.move_to(pos);
+
+    for (auto target : node.targets) {
+        auto &result = (*m_results)[target];
+
+        if (keys.loaded() && KeyDictionary::uses_keys(type)) {
+            // The result has to be readable without the rest of the document
+            bitstream wrapped;
+            keys.wrap(data, size, wrapped);
+            wrapped.move_to(0);
+            result.assign(std::move(wrapped));
+        } else {
+            result = Document(data, size, DocumentMode::ReadOnly);
+        }
+    }
+}
+
+void PathSetSearch::visit_map(const PathSet::Node &node, ObjectType type,
+                              const KeyDictionary &keys) {
+    uint32_t byte_size, size;
+    m_view >> byte_size >> size;
+
+    // Entries with the same key are all visited in order, so the results of
+    // the last one that has a path replace those of earlier ones
+    if (type == ObjectType::SortedMap) {
+        const uint32_t table = m_view.pos();
+
+        for (auto child : node.children) {
+            m_view.move_to(table);
+            const auto [first, last] =
+                find_sorted_keys(m_view, size, m_paths.m_nodes[child].key);
+
+            for (uint32_t pos = first; pos < last; ++pos) {
+                m_view.move_to(table);
+                move_to_sorted_value(m_view, size, pos);
+                visit(child, keys);
+            }
+        }
+
+        return;
+    }
+
+    const size_t count = node.children.size();
+
+    for (uint32_t i = 0; i < size; ++i) {
+        const auto key = keys.read_key(type, m_view);
+        const size_t child = find_child(node, key);
+
+        if (child < count) {
+            visit_child(node.children[child], keys);
+        } else {
+            ObjectType child_type;
+            m_view >> child_type;
+            skip_next(child_type, m_view);
+        }
+    }
+}
+
+void PathSetSearch::visit_array(const PathSet::Node &node,
+                                const KeyDictionary &keys) {
+    uint32_t byte_size, size;
+    m_view >> byte_size >> size;
+
+    uint32_t end = 0;
+
+    for (auto child : node.children) {
+        const auto &child_node = m_paths.m_nodes[child];
+
+        if (child_node.is_index) {
+            end = std::max(end, child_node.index + 1);
+        }
+    }
+
+    end = std::min(end, size);
+
+    for (uint32_t i = 0; i < end; ++i) {
+        const size_t child = find_child(node, i);
+
+        if (child < node.children.size()) {
+            visit_child(node.children[child], keys);
+        } else {
+            ObjectType child_type;
+            m_view >> child_type;
+            skip_next(child_type, m_view);
+        }
+    }
+}
+
+void PathSetSearch::visit_typed_array(const PathSet::Node &node) {
+    ObjectType element_type;
+    uint32_t size;
+    read_typed_array(m_view, element_type, size);
+
+    const uint8_t *values = m_view.current();
+
+    // Elements are scalars, so paths have to end at them
+    for (auto child : node.children) {
+        const auto &child_node = m_paths.m_nodes[child];
+
+        if (!child_node.is_index || child_node.index >= size) {
+            continue;
+        }
+
+        for (auto target : child_node.targets) {
+            // Elements do not have a type, so the result has to be a copy
+            bitstream element;
+            element << element_type;
+            element.write_raw_data(
+                values + child_node.index * TYPED_ARRAY_ELEMENT_SIZE,
+                TYPED_ARRAY_ELEMENT_SIZE);
+            element.move_to(0);
+
+            (*m_results)[target].assign(std::move(element));
+        }
+    }
+}
+
+void PathSetSearch::visit_child(uint32_t node, const KeyDictionary &keys) {
+    const uint32_t start = m_view.pos();
+    visit(node, keys);
+
+    m_view.move_to(start);
+
+    ObjectType type;
+    m_view >> type;
+    skip_next(type, m_view);
+}
+
+size_t PathSetSearch::find_child(const PathSet::Node &node,
+                                 std::string_view key) const {
+    for (size_t i = 0; i < node.children.size(); ++i) {
+        const auto &child_key = m_paths.m_nodes[node.children[i]].key;
+
+        if (child_key.size() == key.size() && child_key == key) {
+            return i;
+        }
+    }
+
+    return node.children.size();
+}
+
+size_t PathSetSearch::find_child(const PathSet::Node &node,
+                                 uint32_t index) const {
+    for (size_t i = 0; i < node.children.size(); ++i) {
+        const auto &child = m_paths.m_nodes[node.children[i]];
+
+        if (child.is_index && child.index == index) {
+            return i;
+        }
+    }
+
+    return node.children.size();
+}
+
+} // namespace json
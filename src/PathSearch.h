@@ -0,0 +1,121 @@
+#pragma once
+
+#include <json/Path.h>
+#include <json/json.h>
+
+#include "DocumentTraversal.h"
+#include "KeyDictionary.h"
+
+namespace json {
+
+/**
+ * Looks up a compiled path
+ *
+ * Unlike Search, this only visits the values on the path. The result is the
+ * same, also if a map holds a key more than once: of the entries that have
+ * the rest of the path, the last one is used.
+ */
+class PathSearch : public DocumentTraversal {
+  public:
+    PathSearch(const Document &document, const Path &path);
+
+    bool do_search();
+
+    bitstream get_result() { return std::move(m_result); }
+
+  private:
+    /**
+     * Look up the rest of the path, starting at the value at the view
+     *
+     * \returns false if it was not found
+     */
+    bool search(size_t depth);
+
+    /**
+     * Look up the rest of the path below each entry of the current map that
+     * has the key at depth
+     *
+     * The view has to be placed right after the type of the map.
+     */
+    bool search_map(ObjectType type, size_t depth);
+
+    /**
+     * Move the view to the element at pos of the current array
+     */
+    bool find_element(uint32_t pos);
+
+    /**
+     * Set the result to the value at the current position
+     */
+    void set_result(uint32_t start, ObjectType type);
+
+    const json::Document &m_document;
+    const Path &m_path;
+
+    bitstream m_view;
+    bitstream m_result;
+
+    /// The dictionary of the value that is currently visited, if any
+    KeyDictionary m_keys;
+};
+
+/**
+ * Looks up all paths of a PathSet in a single pass
+ *
+ * Only values on one of the paths are visited. Duplicate keys are handled
+ * like in PathSearch.
+ */
+class PathSetSearch : public DocumentTraversal {
+  public:
+    PathSetSearch(const Document &document, const PathSet &paths);
+
+    /**
+     * Set results[i] to a view of the value at the i-th path
+     *
+     * Paths that are not found are left as they are.
+     */
+    void do_search(std::vector<Document> &results);
+
+  private:
+    /**
+     * Visit the value at the current position, which is at the given node
+     * of the trie
+     *
+     * The view is left at an unspecified position.
+     */
+    void visit(uint32_t node, KeyDictionary keys);
+
+    /**
+     * Set the results of all paths that end at the current value
+     *
+     * The view has to be placed right after the type of the value at start.
+     * It is not moved.
+     */
+    void set_results(const PathSet::Node &node, uint32_t start,
+                     ObjectType type, const KeyDictionary &keys);
+
+    void visit_map(const PathSet::Node &node, ObjectType type,
+                   const KeyDictionary &keys);
+    void visit_array(const PathSet::Node &node, const KeyDictionary &keys);
+    void visit_typed_array(const PathSet::Node &node);
+
+    /**
+     * Visit the value at the current position and move past it
+     */
+    void visit_child(uint32_t node, const KeyDictionary &keys);
+
+    /**
+     * The position of the child with this key among the children of the
+     * node, or the number of children if there is none
+     */
+    size_t find_child(const PathSet::Node &node, std::string_view key) const;
+    size_t find_child(const PathSet::Node &node, uint32_t index) const;
+
+    const json::Document &m_document;
+    const PathSet &m_paths;
+
+    bitstream m_view;
+    std::vector<Document> *m_results = nullptr;
+};
+
+} // namespace json
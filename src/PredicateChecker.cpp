@@ -61,6 +61,11 @@ void PredicateChecker::push_key(const std::string &key) {
             case ObjectType::Float:
                 val.floating = view.as_float();
                 break;
+            case ObjectType::Datetime:
+            case ObjectType::Timestamp:
+                val.type = ObjectType::Timestamp;
+                val.integer = view.as_timestamp().micros;
+                break;
             default:
                 val.type = ObjectType::Null;
                 break;
@@ -107,6 +112,11 @@ void PredicateChecker::push_key(const std::string &key) {
             case ObjectType::String:
                 val.str = view.as_string();
                 break;
+            case ObjectType::Datetime:
+            case ObjectType::Timestamp:
+                val.type = ObjectType::Timestamp;
+                val.integer = view.as_timestamp().micros;
+                break;
             default:
                 val.type = ObjectType::Null;
                 break;
@@ -167,8 +177,7 @@ void PredicateChecker::handle_string(const std::string &key,
                 continue;
             }
 
-            std::string other = view.as_string();
-            if (other == value) {
+            if (view.as_string_view() == value) {
                 found = true;
             }
         }
@@ -403,6 +412,71 @@ void PredicateChecker::handle_datetime(const std::string &key,
     (void)value;
 }
 
+void PredicateChecker::handle_timestamp(const std::string &key,
+                                        const timestamp_t &value) {
+    push_path(key);
+
+    // Datetimes are compared by the point in time they refer to
+    if (mode() == predicate_mode::NORMAL) {
+        bool found = false;
+
+        for (auto &path : path_strings(m_path, m_document)) {
+            Document view(m_document, path, false);
+
+            if (view.empty() || (view.get_type() != ObjectType::Timestamp &&
+                                 view.get_type() != ObjectType::Datetime)) {
+                continue;
+            }
+
+            if (view.as_timestamp().micros == value.micros) {
+                found = true;
+            }
+        }
+
+        if (!found) {
+            m_matched = false;
+        }
+    } else {
+        for (auto &val : m_pred_values) {
+            if (val.type != ObjectType::Timestamp) {
+                continue;
+            }
+
+            bool matches = false;
+
+            switch (mode()) {
+            case predicate_mode::IN:
+            case predicate_mode::EQUAL:
+                matches = val.integer == value.micros;
+                break;
+            case predicate_mode::NOT_EQUAL:
+                matches = val.integer != value.micros;
+                break;
+            case predicate_mode::LESS_THAN:
+                matches = val.integer < value.micros;
+                break;
+            case predicate_mode::LESS_THAN_EQUAL:
+                matches = val.integer <= value.micros;
+                break;
+            case predicate_mode::GREATER_THAN:
+                matches = val.integer > value.micros;
+                break;
+            case predicate_mode::GREATER_THAN_EQUAL:
+                matches = val.integer >= value.micros;
+                break;
+            default:
+                break;
+            }
+
+            if (matches) {
+                m_pred_matches = true;
+            }
+        }
+    }
+
+    pop_path();
+}
+
 void PredicateChecker::handle_map_end() { pop_path(); }
 
 void PredicateChecker::handle_array_start(const std::string &key) {
@@ -23,6 +23,8 @@ class PredicateChecker : public Iterator {
     void handle_boolean(const std::string &key, const bool value) override;
     void handle_null(const std::string &key) override;
     void handle_datetime(const std::string &key, const tm &value) override;
+    void handle_timestamp(const std::string &key,
+                          const timestamp_t &value) override;
     void handle_map_end() override;
     void handle_array_start(const std::string &key) override;
     void handle_array_end() override;
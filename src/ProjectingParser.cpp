@@ -0,0 +1,313 @@
+#include "ProjectingParser.h"
+#include "json.h"
+
+#include <algorithm>
+#include <charconv>
+
+namespace json {
+
+path_node *path_node::find(std::string_view child_name) {
+    for (auto &child : children) {
+        if (child.name == child_name) {
+            return &child;
+        }
+    }
+
+    return nullptr;
+}
+
+const path_node *path_node::find(std::string_view child_name) const {
+    return const_cast<path_node *>(this)->find(child_name);
+}
+
+void path_node::add(std::string_view path) {
+    std::vector<path_node *> nodes = {this};
+    size_t last_pos = 0;
+
+    while (!path.empty()) {
+        const size_t pos = path.find('.', last_pos);
+        const auto name = path.substr(last_pos, pos - last_pos);
+
+        path_node *child = nodes.back()->find(name);
+
+        if (child == nullptr) {
+            child = &nodes.back()->children.emplace_back();
+            child->name = name;
+        }
+
+        nodes.push_back(child);
+
+        if (pos == std::string_view::npos) {
+            break;
+        }
+
+        last_pos = pos + 1;
+    }
+
+    nodes.back()->target = true;
+
+    auto last_wildcard = nodes.end();
+
+    for (auto node = nodes.begin(); node != nodes.end(); ++node) {
+        if ((*node)->name == keyword(WILDCARD)) {
+            last_wildcard = node;
+        }
+    }
+
+    if (last_wildcard != nodes.end()) {
+        for (auto node = nodes.begin(); node != last_wildcard; ++node) {
+            (*node)->wildcard = true;
+        }
+    }
+
+    // Everything from the last wildcard on leads to the target directly
+    for (auto node = nodes.rbegin(); node != nodes.rend(); ++node) {
+        (*node)->fixed = true;
+
+        if ((*node)->name == keyword(WILDCARD)) {
+            break;
+        }
+    }
+}
+
+ProjectingParser::ProjectingParser(std::string_view str_, bitstream &result_,
+                                   const path_node &paths,
+                                   bool keep_positions)
+    : IndexedParser(str_, result_), m_result(result_), m_root(paths),
+      m_keep_positions(keep_positions) {}
+
+ProjectingParser::ProjectingParser(std::string_view str_, bitstream &result_,
+                                   const StructuralIndex &index,
+                                   const path_node &paths,
+                                   bool keep_positions)
+    : IndexedParser(str_, result_, index), m_result(result_), m_root(paths),
+      m_keep_positions(keep_positions) {}
+
+bool ProjectingParser::do_parse() {
+    if (!has_structural()) {
+        return true;
+    }
+
+    try {
+        project_value("", {&m_root});
+    } catch (const ambiguous_key &) {
+        return false;
+    }
+
+    return true;
+}
+
+bool ProjectingParser::is_fixed(const node_set &nodes) {
+    for (auto node : nodes) {
+        if (node->fixed) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ProjectingParser::has_wildcard(const node_set &nodes) {
+    for (auto node : nodes) {
+        if (node->wildcard) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ProjectingParser::project_value(std::string_view key,
+                                     const node_set &nodes) {
+    for (auto node : nodes) {
+        if (node->target) {
+            parse_value(key);
+            return true;
+        }
+    }
+
+    const uint32_t start = m_result.pos();
+    bool keep = false;
+
+    switch (peek_structural()) {
+    case '{':
+        ++m_next;
+        keep = project_map(key, nodes);
+        break;
+    case '[':
+        ++m_next;
+        keep = project_array(key, nodes);
+        break;
+    default:
+        // Scalars are only kept if they are selected
+        skip_value();
+        return false;
+    }
+
+    if (!keep && !is_fixed(nodes)) {
+        writer.discard_value(start);
+        return false;
+    }
+
+    return true;
+}
+
+bool ProjectingParser::project_map(std::string_view key,
+                                   const node_set &nodes) {
+    writer.start_map(key);
+
+    if (peek_structural() == '}') {
+        ++m_next;
+        writer.end_map();
+        return false;
+    }
+
+    bool keep = false;
+    node_set children;
+
+    // Keys that lead to a wildcard, which must not appear again
+    std::vector<std::string> wildcard_keys;
+
+    while (true) {
+        it = str.begin() + next_structural("Map not terminated!");
+
+        auto child_key = read_key();
+        finish_scalar();
+
+        if (str[next_structural("Map not terminated!")] != ':') {
+            throw json_parse_error(ParseErrorCode::InvalidMap,
+                                   "Not a valid map");
+        }
+
+        children.clear();
+
+        if (child_key != keyword(WILDCARD)) {
+            for (auto node : nodes) {
+                if (auto child = node->find(child_key)) {
+                    children.push_back(child);
+                }
+            }
+        }
+
+        if (has_wildcard(children)) {
+            if (std::find(wildcard_keys.begin(), wildcard_keys.end(),
+                          child_key) != wildcard_keys.end()) {
+                throw ambiguous_key();
+            }
+
+            wildcard_keys.emplace_back(child_key);
+        }
+
+        if (children.empty()) {
+            skip_value();
+        } else if (project_value(child_key, children) || is_fixed(children)) {
+            keep = true;
+        }
+
+        auto c = str[next_structural("Map not terminated!")];
+
+        if (c == '}') {
+            break;
+        } else if (c != ',') {
+            throw json_parse_error(ParseErrorCode::InvalidMap,
+                                   "Not a valid map");
+        }
+    }
+
+    writer.end_map();
+    return keep;
+}
+
+bool ProjectingParser::project_array(std::string_view key,
+                                     const node_set &nodes) {
+    writer.start_array(key);
+
+    if (peek_structural() == ']') {
+        ++m_next;
+        writer.end_array();
+        return false;
+    }
+
+    bool keep = false;
+    node_set children;
+
+    for (uint32_t pos = 0;; ++pos) {
+        char index[16];
+        auto res = std::to_chars(index, index + sizeof(index), pos);
+        const std::string_view index_key(index, res.ptr - index);
+
+        children.clear();
+
+        for (auto node : nodes) {
+            if (auto child = node->find(index_key)) {
+                children.push_back(child);
+            }
+
+            if (auto child = node->find(keyword(WILDCARD))) {
+                children.push_back(child);
+            }
+        }
+
+        // Writer ignores keys inside of arrays
+        bool written = false;
+
+        if (children.empty()) {
+            skip_value();
+        } else {
+            written = project_value("", children);
+            keep = keep || written || is_fixed(children);
+        }
+
+        if (!written && m_keep_positions) {
+            writer.write_null("");
+        }
+
+        auto c = str[next_structural("Array not terminated!")];
+
+        if (c == ']') {
+            break;
+        } else if (c != ',') {
+            throw json_parse_error(ParseErrorCode::InvalidArray,
+                                   "Not a valid array");
+        }
+    }
+
+    writer.end_array();
+    return keep;
+}
+
+void ProjectingParser::skip_value() {
+    switch (str[next_structural("Invalid JSON value")]) {
+    case '{':
+    case '[':
+        break;
+    case '}':
+    case ']':
+    case ':':
+    case ',':
+        throw json_parse_error(ParseErrorCode::InvalidValue,
+                               "Invalid JSON value");
+    default:
+        // Strings and other scalars only have a single structural
+        return;
+    }
+
+    size_t depth = 1;
+
+    while (depth > 0) {
+        switch (str[next_structural("Value not terminated!")]) {
+        case '{':
+        case '[':
+            ++depth;
+            break;
+        case '}':
+        case ']':
+            --depth;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+} // namespace json
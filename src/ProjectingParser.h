@@ -0,0 +1,118 @@
+#pragma once
+
+#include "IndexedParser.h"
+
+#include <string>
+#include <vector>
+
+namespace json {
+
+/**
+ * Paths to keep, stored as a tree of path components
+ */
+struct path_node {
+    std::string name;
+
+    /// Keep this value and everything below it
+    bool target = false;
+
+    /**
+     * There is a target below this node that is reached without a wildcard
+     *
+     * Maps and arrays at such a node are kept even if nothing in them is
+     * selected, like Projection does for paths that do not exist.
+     */
+    bool fixed = false;
+
+    /**
+     * There is a wildcard below this node
+     *
+     * Projection expands a wildcard only at the last map entry that has the
+     * whole path up to it, so such nodes must not be reached through a key
+     * that appears more than once in a map.
+     */
+    bool wildcard = false;
+
+    std::vector<path_node> children;
+
+    path_node *find(std::string_view child_name);
+
+    const path_node *find(std::string_view child_name) const;
+
+    /**
+     * Add a dotted path below this node and mark its last component as target
+     */
+    void add(std::string_view path);
+};
+
+/**
+ * Parses only the parts of the JSON text that are selected by a set of paths
+ *
+ * The result is the same as parsing everything and applying a Projection to
+ * the document afterwards, i.e. maps and arrays on the way to a selected value
+ * are kept. Subtrees that are not selected are skipped by walking the
+ * structural index, without decoding or validating their contents. Wildcards
+ * match every element of an array and nothing else, so a map key named "*"
+ * can not be selected. Maps and arrays that are only on the way to a wildcard
+ * are taken back if it does not match anything.
+ */
+class ProjectingParser : public IndexedParser {
+  public:
+    /**
+     * \param paths
+     *      The tree of paths to keep. It is not copied and must outlive the
+     *      parser.
+     * \param keep_positions
+     *      Write null in place of array elements that are not selected, so
+     *      that the remaining ones keep their index
+     */
+    ProjectingParser(std::string_view str_, bitstream &result_,
+                     const path_node &paths, bool keep_positions = false);
+
+    /**
+     * Use an index that has already been built for the input
+     */
+    ProjectingParser(std::string_view str_, bitstream &result_,
+                     const StructuralIndex &index, const path_node &paths,
+                     bool keep_positions = false);
+
+    /**
+     * \returns false if the result depends on a later duplicate key, see
+     *      path_node::wildcard. The result is incomplete then, and the caller
+     *      has to parse everything and apply a Projection instead.
+     */
+    bool do_parse();
+
+  private:
+    /// Thrown to stop at a key that makes the projection ambiguous
+    struct ambiguous_key {};
+
+    /// All path nodes that match the current value
+    using node_set = std::vector<const path_node *>;
+
+    /**
+     * \returns false if the value was skipped or taken back
+     */
+    bool project_value(std::string_view key, const node_set &nodes);
+
+    /**
+     * \returns true if one of the children has to be kept, i.e. it was
+     *      written or a fixed path leads through it
+     */
+    bool project_map(std::string_view key, const node_set &nodes);
+    bool project_array(std::string_view key, const node_set &nodes);
+
+    static bool is_fixed(const node_set &nodes);
+    static bool has_wildcard(const node_set &nodes);
+
+    /**
+     * Move past the next value without parsing it
+     */
+    void skip_value();
+
+    bitstream &m_result;
+    const path_node &m_root;
+    const bool m_keep_positions;
+};
+
+} // namespace json
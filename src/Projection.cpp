@@ -1,4 +1,6 @@
 #include "Projection.h"
+#include "DocumentRewriter.h"
+#include "TypedArray.h"
 #include "json.h"
 
 namespace json {
@@ -31,11 +33,8 @@ Projection::Projection(const Document &document,
     }
 }
 
-void Projection::parse_next(json::Writer &writer) {
-    auto current = path_string(m_current_path);
-    bool on_path = false;
-    bool on_target = false;
-
+void Projection::match(const std::string &current, bool &on_path,
+                       bool &on_target) const {
     for (auto &target_path : m_target_paths) {
         auto len = std::min(current.size(), target_path.size());
 
@@ -53,6 +52,12 @@ void Projection::parse_next(json::Writer &writer) {
             }
         }
     }
+}
+
+void Projection::parse_next(json::Writer &writer) {
+    bool on_path = false;
+    bool on_target = false;
+    match(path_string(m_current_path), on_path, on_target);
 
     std::string key;
 
@@ -76,7 +81,14 @@ void Projection::parse_next(json::Writer &writer) {
         uint32_t end = m_view.pos();
 
         std::string nkey = m_write_path ? key : "";
-        writer.write_raw_data(nkey, &m_view.data()[start], end - start);
+
+        if (m_keys.loaded() && KeyDictionary::uses_keys(type)) {
+            // Expand the keys, as the result has no dictionary
+            m_view.move_to(start);
+            DocumentRewriter(writer, false, true).copy(m_view, nkey, m_keys);
+        } else {
+            writer.write_raw_data(nkey, &m_view.data()[start], end - start);
+        }
 
         m_found_count += 1;
         return;
@@ -99,17 +111,43 @@ void Projection::parse_next(json::Writer &writer) {
         break;
     }
     case ObjectType::Map:
-        parse_map(writer);
+    case ObjectType::SortedMap:
+    case ObjectType::DictionaryMap:
+        parse_map(type, writer);
+        break;
+    case ObjectType::KeyDictionary: {
+        // The value inside is at the same path
+        const auto outer = m_keys;
+        std::vector<bool> outer_wanted;
+        outer_wanted.swap(m_wanted_keys);
+
+        load_keys();
+        parse_next(writer);
+
+        m_keys = outer;
+        m_wanted_keys.swap(outer_wanted);
         break;
+    }
     case ObjectType::Array:
         parse_array(writer);
         break;
+    case ObjectType::TypedArray:
+        parse_typed_array(writer);
+        break;
     case ObjectType::Binary: {
         uint32_t len = 0;
         m_view >> len;
         m_view.move_by(len);
         break;
     }
+    case ObjectType::Datetime: {
+        m_view.move_by(sizeof(tm));
+        break;
+    }
+    case ObjectType::Timestamp: {
+        m_view.move_by(TIMESTAMP_SIZE);
+        break;
+    }
     case ObjectType::True:
     case ObjectType::False:
     case ObjectType::Null:
@@ -119,13 +157,15 @@ void Projection::parse_next(json::Writer &writer) {
     }
 }
 
-void Projection::parse_map(json::Writer &writer) {
+void Projection::parse_map(ObjectType type, json::Writer &writer) {
     uint32_t byte_size = 0;
     m_view >> byte_size;
 
     uint32_t size = 0;
     m_view >> size;
 
+    skip_key_table(type, size, m_view);
+
     std::string key = m_current_path.empty() ? "" : m_current_path.back();
 
     if (m_write_path) {
@@ -133,10 +173,26 @@ void Projection::parse_map(json::Writer &writer) {
     }
 
     for (uint32_t i = 0; i < size; ++i) {
-        std::string key;
-        m_view >> key;
+        if (type == ObjectType::DictionaryMap) {
+            key_id_t id;
+            m_view >> id;
+
+            // Keys that are on no path do not need to be looked at
+            if (id >= m_wanted_keys.size() || !m_wanted_keys[id]) {
+                ObjectType child_type;
+                m_view >> child_type;
+                skip_next(child_type, m_view);
+                continue;
+            }
+
+            m_current_path.emplace_back(m_keys[id]);
+        } else {
+            std::string key;
+            m_view >> key;
+
+            m_current_path.push_back(key);
+        }
 
-        m_current_path.push_back(key);
         parse_next(writer);
         m_current_path.pop_back();
     }
@@ -146,6 +202,28 @@ void Projection::parse_map(json::Writer &writer) {
     }
 }
 
+void Projection::load_keys() {
+    m_keys.load(m_view);
+    m_wanted_keys.assign(m_keys.size(), false);
+
+    for (auto &path : m_target_paths) {
+        size_t pos = 0, last_pos = 0;
+
+        do {
+            pos = path.find('.', last_pos);
+
+            const auto id = m_keys.find(
+                std::string_view(path).substr(last_pos, pos - last_pos));
+
+            if (id != NO_KEY) {
+                m_wanted_keys[id] = true;
+            }
+
+            last_pos = pos + 1;
+        } while (pos != std::string::npos);
+    }
+}
+
 void Projection::parse_array(json::Writer &writer) {
     uint32_t byte_size = 0;
     m_view >> byte_size;
@@ -170,4 +248,44 @@ void Projection::parse_array(json::Writer &writer) {
     }
 }
 
+void Projection::parse_typed_array(json::Writer &writer) {
+    ObjectType element_type;
+    uint32_t size = 0;
+    read_typed_array(m_view, element_type, size);
+
+    std::string key = m_current_path.empty() ? "" : m_current_path.back();
+
+    if (m_write_path) {
+        writer.start_array(key);
+    }
+
+    for (uint32_t i = 0; i < size; ++i) {
+        m_current_path.push_back(to_string(i));
+
+        bool on_path = false;
+        bool on_target = false;
+        match(path_string(m_current_path), on_path, on_target);
+
+        m_current_path.pop_back();
+
+        if (!on_target) {
+            m_view.move_by(TYPED_ARRAY_ELEMENT_SIZE);
+        } else if (element_type == ObjectType::Integer) {
+            integer_t value;
+            m_view >> value;
+            writer.write_integer(m_write_path ? to_string(i) : "", value);
+            m_found_count += 1;
+        } else {
+            json::float_t value;
+            m_view >> value;
+            writer.write_float(m_write_path ? to_string(i) : "", value);
+            m_found_count += 1;
+        }
+    }
+
+    if (m_write_path) {
+        writer.end_array();
+    }
+}
+
 } // namespace json
@@ -3,6 +3,7 @@
 #include <json/json.h>
 
 #include "DocumentTraversal.h"
+#include "KeyDictionary.h"
 
 namespace json {
 
@@ -38,7 +39,25 @@ class Projection : public DocumentTraversal {
     const bool m_write_path;
     uint32_t m_found_count;
 
-    void parse_map(json::Writer &writer);
+    /// The dictionary of the value that is currently visited, if any
+    KeyDictionary m_keys;
+
+    /// Which ids of m_keys appear in any of the target paths
+    std::vector<bool> m_wanted_keys;
+
+    void parse_map(ObjectType type, json::Writer &writer);
+    void parse_typed_array(json::Writer &writer);
+
+    /**
+     * Check if the value at path is on one of the target paths
+     */
+    void match(const std::string &path, bool &on_path, bool &on_target) const;
+
+    /**
+     * Load the dictionary at the current position and look up the ids of
+     * all path components in it
+     */
+    void load_keys();
     void parse_array(json::Writer &writer);
 };
 
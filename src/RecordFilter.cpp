@@ -0,0 +1,180 @@
+#include "RecordFilter.h"
+#include "Iterator.h"
+#include "json.h"
+
+#include <stack>
+
+namespace json {
+
+namespace {
+
+inline bool is_operator(std::string_view key) {
+    return key == keyword(IN) || key == keyword(LESS_THAN) ||
+           key == keyword(LESS_THAN_EQUAL) || key == keyword(GREATER_THAN) ||
+           key == keyword(GREATER_THAN_EQUAL) || key == keyword(EQUAL) ||
+           key == keyword(NOT_EQUAL);
+}
+
+/**
+ * Collects the paths a PredicateChecker will look up in the document
+ *
+ * These are the paths of all values in the predicates, split at dots like
+ * PredicateChecker::push_path does and cut off at the first operator. The
+ * operands of an operator are not paths themselves.
+ */
+class PredicatePaths : public Iterator {
+  public:
+    explicit PredicatePaths(path_node &paths) : m_paths(paths) {}
+
+    void handle_string(const std::string &key,
+                       const std::string &value) override {
+        (void)value;
+        handle_value(key);
+    }
+
+    void handle_integer(const std::string &key,
+                        const integer_t value) override {
+        (void)value;
+        handle_value(key);
+    }
+
+    void handle_float(const std::string &key,
+                      const json::float_t value) override {
+        (void)value;
+        handle_value(key);
+    }
+
+    void handle_boolean(const std::string &key, const bool value) override {
+        (void)value;
+        handle_value(key);
+    }
+
+    void handle_null(const std::string &key) override { handle_value(key); }
+
+    void handle_datetime(const std::string &key, const tm &value) override {
+        (void)value;
+        handle_value(key);
+    }
+
+    void handle_binary(const std::string &key, const uint8_t *data,
+                       uint32_t len) override {
+        (void)data;
+        (void)len;
+        handle_value(key);
+    }
+
+    void handle_map_start(const std::string &key) override { push(key); }
+
+    void handle_map_end() override { pop(); }
+
+    void handle_array_start(const std::string &key) override { push(key); }
+
+    void handle_array_end() override { pop(); }
+
+  private:
+    struct frame {
+        size_t num_keys;
+        bool is_operand;
+    };
+
+    void handle_value(const std::string &key) {
+        push(key);
+
+        if (m_num_operands == 0) {
+            m_paths.add(path_string(m_path));
+        }
+
+        pop();
+    }
+
+    void push(const std::string &key) {
+        frame f = {0, m_num_operands > 0};
+
+        size_t last_pos = 0;
+
+        while (!f.is_operand && !key.empty()) {
+            const size_t pos = key.find('.', last_pos);
+            auto name = key.substr(last_pos, pos - last_pos);
+
+            if (is_operator(name)) {
+                m_paths.add(path_string(m_path));
+                f.is_operand = true;
+                break;
+            }
+
+            m_path.push_back(std::move(name));
+            ++f.num_keys;
+
+            if (pos == std::string::npos) {
+                break;
+            }
+
+            last_pos = pos + 1;
+        }
+
+        if (f.is_operand) {
+            ++m_num_operands;
+        }
+
+        m_frames.push(f);
+    }
+
+    void pop() {
+        const frame f = m_frames.top();
+        m_frames.pop();
+
+        m_path.resize(m_path.size() - f.num_keys);
+
+        if (f.is_operand) {
+            --m_num_operands;
+        }
+    }
+
+    path_node &m_paths;
+    std::vector<std::string> m_path;
+    std::stack<frame, std::vector<frame>> m_frames;
+    size_t m_num_operands = 0;
+};
+
+} // namespace
+
+RecordFilter::RecordFilter(const Document &predicates)
+    : m_predicates(predicates) {
+    if (predicates.empty()) {
+        return;
+    }
+
+    PredicatePaths collector(m_paths);
+    IterationEngine engine(predicates.data(), collector);
+    engine.run();
+
+    // Keep the top-level value even if no wildcard matches, so that the
+    // checker always gets a document
+    m_paths.fixed = true;
+}
+
+bool RecordFilter::matches(std::string_view record,
+                           const StructuralIndex &index) const {
+    if (m_predicates.empty()) {
+        return true;
+    }
+
+    Document doc;
+
+    ProjectingParser parser(record, doc.mutable_data(), index, m_paths, true);
+
+    if (parser.do_parse()) {
+        parser.finish_input();
+    } else {
+        doc = Document();
+
+        IndexedParser full(record, doc.mutable_data(), index);
+        full.do_parse();
+        full.finish_input();
+    }
+
+    doc.mutable_data().move_to(0);
+    return doc.matches_predicates(m_predicates);
+}
+
+} // namespace json
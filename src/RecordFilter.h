@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ProjectingParser.h"
+
+namespace json {
+
+/**
+ * Checks records against predicates before they are parsed in full
+ *
+ * Only the values that the predicates refer to are extracted from the text.
+ * They are checked by a PredicateChecker, so the result is the same as that
+ * of Document::matches_predicates on the fully parsed record. Array elements
+ * that are not needed are replaced by null, so that paths with an index or a
+ * wildcard still resolve to the same values.
+ */
+class RecordFilter {
+  public:
+    /**
+     * The predicates are not copied and must outlive the filter
+     */
+    explicit RecordFilter(const Document &predicates);
+
+    /**
+     * \param index
+     *      The structural index of the record. It can be reused to parse
+     *      the record afterwards.
+     * \throws json_error if the relevant parts of the record are not valid
+     */
+    bool matches(std::string_view record, const StructuralIndex &index) const;
+
+  private:
+    const Document &m_predicates;
+    path_node m_paths;
+};
+
+} // namespace json
@@ -0,0 +1,155 @@
+#include "json/Reductions.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(IS_ENCLAVE)
+#define JSON_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace json {
+
+namespace {
+
+void summarize_scalar(const integer_t *values, size_t size,
+                      Summary<integer_t> &summary) {
+    // Unsigned arithmetic makes overflow wrap around instead of being UB
+    auto sum = static_cast<uint64_t>(summary.sum);
+
+    for (size_t i = 0; i < size; ++i) {
+        sum += static_cast<uint64_t>(values[i]);
+        summary.min = std::min(summary.min, values[i]);
+        summary.max = std::max(summary.max, values[i]);
+    }
+
+    summary.sum = static_cast<integer_t>(sum);
+    summary.count += size;
+}
+
+void summarize_scalar(const json::float_t *values, size_t size,
+                      Summary<json::float_t> &summary) {
+    for (size_t i = 0; i < size; ++i) {
+        if (std::isnan(values[i])) {
+            continue;
+        }
+
+        summary.sum += values[i];
+        summary.min = std::min(summary.min, values[i]);
+        summary.max = std::max(summary.max, values[i]);
+        ++summary.count;
+    }
+}
+
+#ifdef JSON_X86_KERNELS
+
+__attribute__((target("avx2"))) void
+summarize_avx2(const integer_t *values, size_t size,
+               Summary<integer_t> &summary) {
+    __m256i sum = _mm256_setzero_si256();
+    __m256i min = _mm256_set1_epi64x(summary.min);
+    __m256i max = _mm256_set1_epi64x(summary.max);
+
+    size_t i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        const __m256i value = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(values + i));
+
+        sum = _mm256_add_epi64(sum, value);
+        min = _mm256_blendv_epi8(min, value, _mm256_cmpgt_epi64(min, value));
+        max = _mm256_blendv_epi8(max, value, _mm256_cmpgt_epi64(value, max));
+    }
+
+    alignas(32) integer_t sums[4], mins[4], maxs[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(sums), sum);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(mins), min);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(maxs), max);
+
+    auto total = static_cast<uint64_t>(summary.sum);
+
+    for (size_t lane = 0; lane < 4; ++lane) {
+        total += static_cast<uint64_t>(sums[lane]);
+        summary.min = std::min(summary.min, mins[lane]);
+        summary.max = std::max(summary.max, maxs[lane]);
+    }
+
+    summary.sum = static_cast<integer_t>(total);
+    summary.count += i;
+
+    summarize_scalar(values + i, size - i, summary);
+}
+
+__attribute__((target("avx2,popcnt"))) void
+summarize_avx2(const json::float_t *values, size_t size,
+               Summary<json::float_t> &summary) {
+    const __m256d infinity = _mm256_set1_pd(HUGE_VAL);
+    const __m256d negative_infinity = _mm256_set1_pd(-HUGE_VAL);
+
+    __m256d sum = _mm256_setzero_pd();
+    __m256d min = infinity;
+    __m256d max = negative_infinity;
+
+    size_t i = 0;
+
+    for (; i + 4 <= size; i += 4) {
+        const __m256d value = _mm256_loadu_pd(values + i);
+
+        // NaN lanes are replaced with values that do not change the result
+        const __m256d ordered = _mm256_cmp_pd(value, value, _CMP_ORD_Q);
+
+        sum = _mm256_add_pd(sum, _mm256_and_pd(value, ordered));
+        min = _mm256_min_pd(min, _mm256_blendv_pd(infinity, value, ordered));
+        max = _mm256_max_pd(
+            max, _mm256_blendv_pd(negative_infinity, value, ordered));
+
+        summary.count += __builtin_popcount(_mm256_movemask_pd(ordered));
+    }
+
+    alignas(32) json::float_t sums[4], mins[4], maxs[4];
+    _mm256_store_pd(sums, sum);
+    _mm256_store_pd(mins, min);
+    _mm256_store_pd(maxs, max);
+
+    for (size_t lane = 0; lane < 4; ++lane) {
+        summary.sum += sums[lane];
+        summary.min = std::min(summary.min, mins[lane]);
+        summary.max = std::max(summary.max, maxs[lane]);
+    }
+
+    summarize_scalar(values + i, size - i, summary);
+}
+
+bool avx2_supported() {
+    static const bool supported = __builtin_cpu_supports("avx2") &&
+                                  __builtin_cpu_supports("popcnt");
+    return supported;
+}
+
+#endif
+
+template <typename T> Summary<T> summarize_values(std::span<const T> values) {
+    Summary<T> summary;
+
+#ifdef JSON_X86_KERNELS
+    if (avx2_supported()) {
+        summarize_avx2(values.data(), values.size(), summary);
+        return summary;
+    }
+#endif
+
+    summarize_scalar(values.data(), values.size(), summary);
+    return summary;
+}
+
+} // namespace
+
+Summary<integer_t> summarize(std::span<const integer_t> values) {
+    return summarize_values(values);
+}
+
+Summary<json::float_t> summarize(std::span<const json::float_t> values) {
+    return summarize_values(values);
+}
+
+} // namespace json
@@ -1,6 +1,9 @@
 #include "Search.h"
+#include "TypedArray.h"
 #include "json.h"
 
+#include <charconv>
+
 namespace json {
 
 Search::Search(const Document &document, std::string path)
@@ -49,7 +52,15 @@ void Search::parse_next() {
 
         uint32_t end = m_view.pos();
 
-        m_result.assign(&m_view.data()[start], end - start, true);
+        if (m_keys.loaded() && KeyDictionary::uses_keys(type)) {
+            // The result has to be readable without the rest of the document
+            m_result = bitstream();
+            m_keys.wrap(&m_view.data()[start], end - start, m_result);
+            m_result.move_to(0);
+        } else {
+            m_result.assign(&m_view.data()[start], end - start, true);
+        }
+
         m_success = true;
         return;
     }
@@ -74,6 +85,26 @@ void Search::parse_next() {
         parse_map();
         break;
     }
+    case ObjectType::SortedMap: {
+        parse_sorted_map();
+        break;
+    }
+    case ObjectType::DictionaryMap: {
+        parse_dictionary_map();
+        break;
+    }
+    case ObjectType::TypedArray: {
+        parse_typed_array();
+        break;
+    }
+    case ObjectType::KeyDictionary: {
+        // The value inside is at the same path
+        const auto outer = m_keys;
+        m_keys.load(m_view);
+        parse_next();
+        m_keys = outer;
+        break;
+    }
     case ObjectType::Array: {
         parse_array();
         break;
@@ -85,7 +116,11 @@ void Search::parse_next() {
         break;
     }
     case ObjectType::Datetime: {
-        m_view.move_by(sizeof(time_t));
+        m_view.move_by(sizeof(tm));
+        break;
+    }
+    case ObjectType::Timestamp: {
+        m_view.move_by(TIMESTAMP_SIZE);
         break;
     }
     case ObjectType::True:
@@ -116,6 +151,110 @@ void Search::parse_map() {
     }
 }
 
+void Search::parse_sorted_map() {
+    const uint32_t start = m_view.pos();
+
+    uint32_t byte_size = 0;
+    m_view >> byte_size;
+
+    uint32_t size = 0;
+    m_view >> size;
+
+    const auto key = next_key();
+    const uint32_t table = m_view.pos();
+    const auto [first, last] = find_sorted_keys(m_view, size, key);
+
+    // Visit equal keys in order, as in other maps
+    for (uint32_t pos = first; pos < last; ++pos) {
+        m_view.move_to(table);
+        move_to_sorted_value(m_view, size, pos);
+
+        m_current_path.push_back(key);
+        parse_next();
+        m_current_path.pop_back();
+    }
+
+    m_view.move_to(start + sizeof(byte_size) + byte_size);
+}
+
+void Search::parse_dictionary_map() {
+    const uint32_t start = m_view.pos();
+
+    uint32_t byte_size = 0;
+    m_view >> byte_size;
+
+    uint32_t size = 0;
+    m_view >> size;
+
+    const auto key = next_key();
+    const key_id_t target = m_keys.find(key);
+
+    if (target != NO_KEY) {
+        for (uint32_t i = 0; i < size; ++i) {
+            key_id_t id;
+            m_view >> id;
+
+            if (id == target) {
+                m_current_path.push_back(key);
+                parse_next();
+                m_current_path.pop_back();
+            } else {
+                ObjectType type;
+                m_view >> type;
+                skip_next(type, m_view);
+            }
+        }
+    }
+
+    m_view.move_to(start + sizeof(byte_size) + byte_size);
+}
+
+void Search::parse_typed_array() {
+    const uint32_t start = m_view.pos();
+
+    uint32_t byte_size = 0;
+    m_view >> byte_size;
+    m_view.move_to(start);
+
+    ObjectType element_type;
+    uint32_t size;
+    read_typed_array(m_view, element_type, size);
+
+    const auto key = next_key();
+    const char *end = key.data() + key.size();
+
+    uint32_t pos = 0;
+    auto res = std::from_chars(key.data(), end, pos);
+
+    // Elements are scalars, so the target cannot continue below them
+    const auto current = path_string(m_current_path);
+    const size_t key_start = current.empty() ? 0 : current.size() + 1;
+    const bool is_target = key_start + key.size() == m_target_path.size();
+
+    if (is_target && res.ec == std::errc() && pos < size &&
+        to_string(pos) == key) {
+        m_view.move_by(pos * TYPED_ARRAY_ELEMENT_SIZE);
+
+        // Elements do not have a type, so the result has to be a copy
+        m_result = bitstream();
+        m_result << element_type;
+        m_result.write_raw_data(m_view.current(), TYPED_ARRAY_ELEMENT_SIZE);
+        m_result.move_to(0);
+        m_success = true;
+    }
+
+    m_view.move_to(start + sizeof(byte_size) + byte_size);
+}
+
+std::string Search::next_key() const {
+    // The current value is on the path, so the target continues below it
+    const auto current = path_string(m_current_path);
+    const size_t begin = current.empty() ? 0 : current.size() + 1;
+    const size_t end = m_target_path.find('.', begin);
+
+    return m_target_path.substr(begin, end - begin);
+}
+
 void Search::parse_array() {
     uint32_t byte_size = 0;
     m_view >> byte_size;
@@ -3,6 +3,7 @@
 #include <json/json.h>
 
 #include "DocumentTraversal.h"
+#include "KeyDictionary.h"
 
 namespace json {
 
@@ -36,10 +37,33 @@ class Search : public DocumentTraversal {
 
     std::vector<std::string> m_current_path;
 
+    /// The dictionary of the value that is currently visited, if any
+    KeyDictionary m_keys;
+
     bool m_success = false;
 
     void parse_map();
     void parse_array();
+
+    /**
+     * Only visit the entry on the path, which is found by binary search
+     */
+    void parse_sorted_map();
+
+    /**
+     * Only visit the entries on the path, whose keys are compared by id
+     */
+    void parse_dictionary_map();
+
+    /**
+     * Only visit the element on the path, which is found by its position
+     */
+    void parse_typed_array();
+
+    /**
+     * The component of the target path below the current one
+     */
+    std::string next_key() const;
 };
 
 } // namespace json
@@ -0,0 +1,371 @@
+#include "json/StreamParser.h"
+#include "NumberParser.h"
+#include "Parser.h"
+#include "StringDecoder.h"
+#include "json.h"
+
+namespace json {
+
+namespace {
+
+inline bool is_whitespace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/**
+ * Characters that end a number or literal
+ */
+inline bool is_delimiter(char c) {
+    switch (c) {
+    case ' ':
+    case '\n':
+    case '\t':
+    case '\r':
+    case ',':
+    case ':':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '"':
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+StreamParser::StreamParser() : m_strings(new StringDecoder()) {}
+
+StreamParser::~StreamParser() = default;
+
+Document StreamParser::next_document() {
+    if (m_documents.empty()) {
+        throw json_error("No document available");
+    }
+
+    Document doc(std::move(m_documents.front()));
+    m_documents.pop_front();
+    return doc;
+}
+
+void StreamParser::feed(const char *data, size_t length) {
+    const char *pos = data;
+    const char *end = data + length;
+
+    if (m_token != Token::None) {
+        pos = continue_token(pos, end);
+    }
+
+    while (pos != end) {
+        const char c = *pos;
+
+        if (is_whitespace(c)) {
+            ++pos;
+            continue;
+        }
+
+        switch (m_state) {
+        case State::FirstValue:
+            if (c == ']') {
+                ++pos;
+                end_container(ObjectType::Array);
+                break;
+            }
+
+            pos = start_value(pos, end);
+            break;
+        case State::Value:
+            pos = start_value(pos, end);
+            break;
+        case State::FirstKey:
+            if (c == '}') {
+                ++pos;
+                end_container(ObjectType::Map);
+                break;
+            }
+
+            [[fallthrough]];
+        case State::Key:
+            if (c != '"') {
+                throw json_parse_error(ParseErrorCode::InvalidMap,
+                                       "Not a valid map");
+            }
+
+            pos = start_token(Token::Key, pos, end);
+            break;
+        case State::Colon:
+            if (c != ':') {
+                throw json_parse_error(ParseErrorCode::InvalidMap,
+                                       "Not a valid map");
+            }
+
+            ++pos;
+            m_state = State::Value;
+            break;
+        case State::Separator:
+            ++pos;
+
+            if (c == ',') {
+                if (m_containers.top() == ObjectType::Map) {
+                    m_state = State::Key;
+                } else {
+                    m_state = State::Value;
+                }
+            } else if (c == '}') {
+                end_container(ObjectType::Map);
+            } else if (c == ']') {
+                end_container(ObjectType::Array);
+            } else if (m_containers.top() == ObjectType::Map) {
+                throw json_parse_error(ParseErrorCode::InvalidMap,
+                                       "Not a valid map");
+            } else {
+                throw json_parse_error(ParseErrorCode::InvalidArray,
+                                       "Not a valid array");
+            }
+            break;
+        }
+    }
+}
+
+void StreamParser::finish() {
+    // Only numbers and literals can end with the input
+    if (m_token == Token::Number || m_token == Token::Literal) {
+        finish_token(m_token_text);
+    }
+
+    if (m_token != Token::None || !m_containers.empty()) {
+        throw json_parse_error(ParseErrorCode::UnexpectedEnd,
+                               "Unexpected end of input");
+    }
+}
+
+const char *StreamParser::start_value(const char *pos, const char *end) {
+    switch (*pos) {
+    case '{':
+        start_container(ObjectType::Map);
+        return pos + 1;
+    case '[':
+        start_container(ObjectType::Array);
+        return pos + 1;
+    case '"':
+        return start_token(Token::String, pos, end);
+    case 'd':
+        return start_token(Token::Datetime, pos, end);
+    case 't':
+    case 'f':
+    case 'n':
+        return start_token(Token::Literal, pos, end);
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        return start_token(Token::Number, pos, end);
+    default:
+        throw json_parse_error(ParseErrorCode::InvalidValue,
+                               "Invalid JSON value");
+    }
+}
+
+const char *StreamParser::start_token(Token token, const char *pos,
+                                      const char *end) {
+    m_token = token;
+    m_escaped = false;
+    m_quotes = 0;
+
+    const char *token_end = find_token_end(pos, end);
+
+    if (token_end == nullptr) {
+        m_token_text.assign(pos, end - pos);
+        return end;
+    }
+
+    // The token is decoded directly from the input
+    finish_token(std::string_view(pos, token_end - pos));
+    return token_end;
+}
+
+const char *StreamParser::continue_token(const char *pos, const char *end) {
+    const char *token_end = find_token_end(pos, end);
+
+    if (token_end == nullptr) {
+        m_token_text.append(pos, end - pos);
+        return end;
+    }
+
+    m_token_text.append(pos, token_end - pos);
+    finish_token(m_token_text);
+    return token_end;
+}
+
+const char *StreamParser::find_token_end(const char *pos, const char *end) {
+    switch (m_token) {
+    case Token::String:
+    case Token::Key:
+        if (m_quotes == 0) {
+            // Skip the opening quote
+            m_quotes = 1;
+            ++pos;
+        }
+
+        pos = StringDecoder::find_end(pos, end, m_escaped);
+
+        if (pos == end) {
+            return nullptr;
+        }
+
+        return pos + 1;
+    case Token::Datetime:
+        for (; pos != end; ++pos) {
+            if (*pos == '"' && ++m_quotes == 2) {
+                return pos + 1;
+            }
+        }
+
+        return nullptr;
+    case Token::Number:
+    case Token::Literal:
+        for (; pos != end; ++pos) {
+            if (is_delimiter(*pos)) {
+                return pos;
+            }
+        }
+
+        return nullptr;
+    default:
+        throw json_error("Invalid parser state");
+    }
+}
+
+void StreamParser::finish_token(std::string_view text) {
+    const char *begin = text.data();
+    const char *end = begin + text.size();
+
+    const auto token = m_token;
+    m_token = Token::None;
+
+    switch (token) {
+    case Token::Key:
+        m_strings->decode(begin + 1, end);
+        m_key.assign(m_strings->value());
+        m_state = State::Colon;
+        return;
+    case Token::String:
+        m_strings->decode(begin + 1, end);
+        writer().write_string(key(), m_strings->value());
+        break;
+    case Token::Number: {
+        NumberParser number;
+
+        if (number.parse(begin, end) != end) {
+            throw json_parse_error(ParseErrorCode::InvalidNumber,
+                                   "Not a valid number");
+        }
+
+        if (number.is_integer()) {
+            writer().write_integer(key(), number.integer());
+        } else {
+            writer().write_float(key(), number.floating());
+        }
+        break;
+    }
+    case Token::Literal:
+        if (text == keyword(TRUE)) {
+            writer().write_boolean(key(), true);
+        } else if (text == keyword(FALSE)) {
+            writer().write_boolean(key(), false);
+        } else if (text == keyword(NIL)) {
+            writer().write_null(key());
+        } else {
+            throw json_parse_error(ParseErrorCode::InvalidLiteral,
+                                   "Invalid JSON value");
+        }
+        break;
+    case Token::Datetime: {
+        if (text.size() < 2 || text[1] != '"') {
+            throw json_parse_error(ParseErrorCode::InvalidDatetime,
+                                   "Not a datetime structure!");
+        }
+
+        timestamp_t value;
+
+        if (Parser::read_datetime(begin + 2, end, value) != end) {
+            throw json_parse_error(ParseErrorCode::InvalidDatetime,
+                                   "Failed to parse datetime");
+        }
+
+        writer().write_timestamp(key(), value);
+        break;
+    }
+    default:
+        throw json_error("Invalid parser state");
+    }
+
+    value_done();
+}
+
+void StreamParser::start_container(ObjectType type) {
+    if (type == ObjectType::Map) {
+        writer().start_map(key());
+        m_state = State::FirstKey;
+    } else {
+        writer().start_array(key());
+        m_state = State::FirstValue;
+    }
+
+    m_containers.push(type);
+}
+
+void StreamParser::end_container(ObjectType type) {
+    if (m_containers.empty() || m_containers.top() != type) {
+        throw json_parse_error(ParseErrorCode::InvalidValue,
+                               "Invalid JSON value");
+    }
+
+    m_containers.pop();
+
+    if (type == ObjectType::Map) {
+        writer().end_map();
+    } else {
+        writer().end_array();
+    }
+
+    value_done();
+}
+
+void StreamParser::value_done() {
+    if (!m_containers.empty()) {
+        m_state = State::Separator;
+        return;
+    }
+
+    m_documents.push_back(m_writer->make_document());
+    m_writer.reset();
+    m_state = State::Value;
+}
+
+Writer &StreamParser::writer() {
+    if (!m_writer) {
+        m_writer.emplace();
+    }
+
+    return *m_writer;
+}
+
+std::string_view StreamParser::key() const {
+    if (!m_containers.empty() && m_containers.top() == ObjectType::Map) {
+        return m_key;
+    }
+
+    return "";
+}
+
+} // namespace json
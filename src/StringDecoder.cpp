@@ -0,0 +1,307 @@
+#include "StringDecoder.h"
+#include "json/json_error.h"
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#define JSON_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace json {
+
+namespace {
+
+constexpr uint32_t HIGH_SURROGATE_START = 0xD800;
+constexpr uint32_t LOW_SURROGATE_START = 0xDC00;
+constexpr uint32_t SURROGATE_END = 0xE000;
+
+/**
+ * Find the next quote or backslash, i.e. the end of a clean run of characters
+ * inside of a JSON string
+ */
+inline const char *find_quote_or_backslash(const char *pos, const char *end) {
+#ifdef JSON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    for (; end - pos >= 16; pos += 16) {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+        const __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                             _mm_cmpeq_epi8(chunk, backslash));
+        const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; pos != end; ++pos) {
+        if (*pos == '"' || *pos == '\\') {
+            break;
+        }
+    }
+
+    return pos;
+}
+
+/**
+ * Find the next character that cannot appear verbatim in a JSON string
+ */
+inline const char *find_escapable(const char *pos, const char *end) {
+#ifdef JSON_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i last_control = _mm_set1_epi8(0x1F);
+
+    for (; end - pos >= 16; pos += 16) {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos));
+        const __m128i control = _mm_cmpeq_epi8(
+            _mm_max_epu8(chunk, last_control), last_control);
+        const __m128i matches =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                      _mm_cmpeq_epi8(chunk, backslash)),
+                         control);
+        const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; pos != end; ++pos) {
+        const auto c = static_cast<uint8_t>(*pos);
+
+        if (c == '"' || c == '\\' || c < 0x20) {
+            break;
+        }
+    }
+
+    return pos;
+}
+
+inline uint32_t hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    } else {
+        throw json_parse_error(ParseErrorCode::InvalidEscape,
+                               "Invalid unicode escape");
+    }
+}
+
+/**
+ * Read the four hex digits of a \\u escape sequence
+ */
+inline uint32_t read_code_unit(const char *pos, const char *end) {
+    if (end - pos < 4) {
+        throw json_parse_error(ParseErrorCode::InvalidEscape,
+                               "Invalid unicode escape");
+    }
+
+    return (hex_digit(pos[0]) << 12) | (hex_digit(pos[1]) << 8) |
+           (hex_digit(pos[2]) << 4) | hex_digit(pos[3]);
+}
+
+} // namespace
+
+const char *StringDecoder::decode(const char *begin, const char *end) {
+    const char *pos = find_quote_or_backslash(begin, end);
+
+    if (pos != end && *pos == '"') {
+        m_value = std::string_view(begin, pos - begin);
+        return pos + 1;
+    }
+
+    m_buffer.clear();
+    const char *run = begin;
+
+    while (true) {
+        m_buffer.append(run, pos - run);
+
+        if (pos == end) {
+            throw json_parse_error(ParseErrorCode::UnexpectedEnd,
+                                   "String not terminated!");
+        }
+
+        if (*pos == '"') {
+            break;
+        }
+
+        run = decode_escape(pos + 1, end);
+        pos = find_quote_or_backslash(run, end);
+    }
+
+    m_value = m_buffer;
+    return pos + 1;
+}
+
+const char *StringDecoder::find_end(const char *pos, const char *end,
+                                    bool &escaped) {
+    if (escaped) {
+        if (pos == end) {
+            return end;
+        }
+
+        ++pos;
+        escaped = false;
+    }
+
+    while (true) {
+        pos = find_quote_or_backslash(pos, end);
+
+        if (pos == end || *pos == '"') {
+            return pos;
+        }
+
+        // Skip the backslash and the character it escapes
+        if (end - pos < 2) {
+            escaped = true;
+            return end;
+        }
+
+        pos += 2;
+    }
+}
+
+const char *StringDecoder::decode_escape(const char *pos, const char *end) {
+    if (pos == end) {
+        throw json_parse_error(ParseErrorCode::UnexpectedEnd,
+                               "String not terminated!");
+    }
+
+    switch (*pos) {
+    case '"':
+    case '\\':
+    case '/':
+        m_buffer += *pos;
+        break;
+    case 'b':
+        m_buffer += '\b';
+        break;
+    case 'f':
+        m_buffer += '\f';
+        break;
+    case 'n':
+        m_buffer += '\n';
+        break;
+    case 'r':
+        m_buffer += '\r';
+        break;
+    case 't':
+        m_buffer += '\t';
+        break;
+    case 'u': {
+        uint32_t code_point = read_code_unit(pos + 1, end);
+        pos += 5;
+
+        if (code_point >= HIGH_SURROGATE_START &&
+            code_point < LOW_SURROGATE_START) {
+            // Must be followed by the low half of the pair
+            if (end - pos < 2 || pos[0] != '\\' || pos[1] != 'u') {
+                throw json_parse_error(ParseErrorCode::InvalidEscape,
+                                       "Invalid unicode escape");
+            }
+
+            const uint32_t low = read_code_unit(pos + 2, end);
+
+            if (low < LOW_SURROGATE_START || low >= SURROGATE_END) {
+                throw json_parse_error(ParseErrorCode::InvalidEscape,
+                                       "Invalid unicode escape");
+            }
+
+            code_point = 0x10000 + ((code_point - HIGH_SURROGATE_START) << 10) +
+                         (low - LOW_SURROGATE_START);
+            pos += 6;
+        } else if (code_point >= LOW_SURROGATE_START &&
+                   code_point < SURROGATE_END) {
+            throw json_parse_error(ParseErrorCode::InvalidEscape,
+                                   "Invalid unicode escape");
+        }
+
+        append_utf8(code_point);
+        return pos;
+    }
+    default:
+        throw json_parse_error(ParseErrorCode::InvalidEscape,
+                               "Invalid escape sequence");
+    }
+
+    return pos + 1;
+}
+
+void StringDecoder::append_utf8(uint32_t code_point) {
+    if (code_point < 0x80) {
+        m_buffer += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        m_buffer += static_cast<char>(0xC0 | (code_point >> 6));
+        m_buffer += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        m_buffer += static_cast<char>(0xE0 | (code_point >> 12));
+        m_buffer += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        m_buffer += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        m_buffer += static_cast<char>(0xF0 | (code_point >> 18));
+        m_buffer += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        m_buffer += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        m_buffer += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+void append_escaped(std::string &out, std::string_view value) {
+    constexpr const char *HEX_DIGITS = "0123456789abcdef";
+
+    const char *pos = value.data();
+    const char *end = pos + value.size();
+
+    while (true) {
+        const char *next = find_escapable(pos, end);
+        out.append(pos, next - pos);
+
+        if (next == end) {
+            return;
+        }
+
+        const auto c = static_cast<uint8_t>(*next);
+
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        default:
+            out += "\\u00";
+            out += HEX_DIGITS[c >> 4];
+            out += HEX_DIGITS[c & 0xF];
+            break;
+        }
+
+        pos = next + 1;
+    }
+}
+
+} // namespace json
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace json {
+
+/**
+ * Decodes the contents of JSON strings
+ *
+ * Clean runs of characters are located 16 bytes at a time and copied in
+ * bulk. Strings without escape sequences are not copied at all; value() then
+ * refers directly to the input.
+ */
+class StringDecoder {
+  public:
+    /**
+     * Decode a string whose opening quote has already been consumed
+     *
+     * \returns a pointer to the first character after the closing quote
+     * \throws json_error if the string is not terminated or contains an
+     *         invalid escape sequence
+     */
+    const char *decode(const char *begin, const char *end);
+
+    /**
+     * The most recently decoded string
+     *
+     * Only valid until the next call to decode() and as long as the input is
+     */
+    std::string_view value() const { return m_value; }
+
+    /**
+     * Find the closing quote of a string without decoding it
+     *
+     * \param escaped
+     *      Set if the first character is escaped. Updated if the input ends
+     *      right after a backslash, so that scanning can resume with the next
+     *      chunk of input.
+     * \returns a pointer to the closing quote or end, if there is none
+     */
+    static const char *find_end(const char *pos, const char *end,
+                                bool &escaped);
+
+  private:
+    const char *decode_escape(const char *pos, const char *end);
+
+    void append_utf8(uint32_t code_point);
+
+    std::string m_buffer;
+    std::string_view m_value;
+};
+
+/**
+ * Append value to out, escaping all characters that may not appear verbatim
+ * inside of a JSON string
+ */
+void append_escaped(std::string &out, std::string_view value);
+
+} // namespace json
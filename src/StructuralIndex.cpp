@@ -0,0 +1,869 @@
+#include "StructuralIndex.h"
+#include "json/json_error.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(IS_ENCLAVE)
+#define JSON_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace json {
+
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64;
+constexpr uint64_t HIGH_BIT = uint64_t(1) << 63;
+
+/**
+ * Character classes of one block; bit i corresponds to byte i
+ */
+struct block_masks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;
+    uint64_t whitespace;
+};
+
+enum char_class : uint8_t {
+    CLASS_OTHER = 0,
+    CLASS_QUOTE = 1,
+    CLASS_BACKSLASH = 2,
+    CLASS_OP = 4,
+    CLASS_WHITESPACE = 8
+};
+
+struct class_table {
+    uint8_t entries[256] = {};
+
+    constexpr class_table() {
+        entries[static_cast<uint8_t>('"')] = CLASS_QUOTE;
+        entries[static_cast<uint8_t>('\\')] = CLASS_BACKSLASH;
+
+        for (auto c : {'{', '}', '[', ']', ':', ','}) {
+            entries[static_cast<uint8_t>(c)] = CLASS_OP;
+        }
+
+        for (auto c : {' ', '\t', '\n', '\r'}) {
+            entries[static_cast<uint8_t>(c)] = CLASS_WHITESPACE;
+        }
+    }
+};
+
+constexpr class_table CLASS_TABLE;
+
+/**
+ * Find the first byte that is not part of a valid UTF-8 sequence
+ *
+ * Overlong encodings, surrogates and code points above U+10FFFF are invalid.
+ *
+ * \returns the offset of the first byte of the invalid sequence, or length
+ *          if there is none
+ */
+size_t find_invalid_utf8(const uint8_t *input, size_t length) {
+    size_t pos = 0;
+
+    while (pos < length) {
+        // Skip ASCII eight bytes at a time
+        if (length - pos >= sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, input + pos, sizeof(word));
+
+            if ((word & 0x8080808080808080ULL) == 0) {
+                pos += sizeof(word);
+                continue;
+            }
+        }
+
+        const uint8_t lead = input[pos];
+
+        if (lead < 0x80) {
+            ++pos;
+            continue;
+        }
+
+        size_t size;
+        uint32_t code_point;
+        uint32_t min_code_point;
+
+        if ((lead & 0xE0) == 0xC0) {
+            size = 2;
+            code_point = lead & 0x1F;
+            min_code_point = 0x80;
+        } else if ((lead & 0xF0) == 0xE0) {
+            size = 3;
+            code_point = lead & 0x0F;
+            min_code_point = 0x800;
+        } else if ((lead & 0xF8) == 0xF0) {
+            size = 4;
+            code_point = lead & 0x07;
+            min_code_point = 0x10000;
+        } else {
+            return pos;
+        }
+
+        if (length - pos < size) {
+            return pos;
+        }
+
+        for (size_t i = 1; i < size; ++i) {
+            const uint8_t c = input[pos + i];
+
+            if ((c & 0xC0) != 0x80) {
+                return pos;
+            }
+
+            code_point = (code_point << 6) | (c & 0x3F);
+        }
+
+        if (code_point < min_code_point || code_point > 0x10FFFF ||
+            (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+            return pos;
+        }
+
+        pos += size;
+    }
+
+    return length;
+}
+
+[[noreturn]] void throw_invalid_utf8(size_t offset) {
+    throw json_parse_error(ParseErrorCode::InvalidUtf8,
+                           "Invalid UTF-8 at offset " + std::to_string(offset),
+                           offset);
+}
+
+/**
+ * Sets every bit to the parity of all bits at or below its position
+ */
+inline uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+/**
+ * Find all characters that are escaped by an odd-length run of backslashes
+ *
+ * \param carry
+ *      Set if the first byte of this block is escaped; updated for the next
+ *      block
+ */
+inline uint64_t find_escaped(uint64_t backslash, uint64_t &carry) {
+    constexpr uint64_t EVEN_BITS = 0x5555555555555555ULL;
+
+    backslash &= ~carry;
+    const uint64_t follows_escape = (backslash << 1) | carry;
+
+    const uint64_t odd_starts = backslash & ~EVEN_BITS & ~follows_escape;
+
+    uint64_t even_starts = 0;
+    carry =
+        __builtin_add_overflow(odd_starts, backslash, &even_starts) ? 1 : 0;
+
+    const uint64_t invert_mask = even_starts << 1;
+    return (EVEN_BITS ^ invert_mask) & follows_escape;
+}
+
+/**
+ * Turns the character classes of consecutive blocks into positions
+ *
+ * This is shared by all kernels and gets inlined into each of them.
+ */
+class block_indexer {
+  public:
+    explicit block_indexer(std::vector<uint32_t> &positions)
+        : m_positions(positions) {}
+
+    /**
+     * Start over with the first block of a new input
+     */
+    void reset() {
+        m_positions.clear();
+        m_count = 0;
+        m_prev_escaped = 0;
+        m_prev_in_string = 0;
+        m_prev_scalar = 0;
+    }
+
+    size_t count() const { return m_count; }
+
+    /**
+     * Get 64 readable bytes starting at offset; the last block gets padded
+     * with whitespace
+     */
+    static const uint8_t *load_block(const uint8_t *input, size_t length,
+                                     size_t offset, uint8_t *tail) {
+        if (length - offset >= BLOCK_SIZE) {
+            return input + offset;
+        }
+
+        memset(tail, ' ', BLOCK_SIZE);
+        memcpy(tail, input + offset, length - offset);
+        return tail;
+    }
+
+    __attribute__((always_inline)) void add_block(const block_masks &masks,
+                                                  size_t offset) {
+        const uint64_t escaped = find_escaped(masks.backslash, m_prev_escaped);
+        const uint64_t quote = masks.quote & ~escaped;
+
+        // Includes the opening quote but not the closing one
+        const uint64_t in_string = prefix_xor(quote) ^ m_prev_in_string;
+        m_prev_in_string =
+            static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+
+        // Values start at any non-whitespace character that does not follow
+        // another one (or follows a closing quote)
+        const uint64_t scalar = ~(masks.op | masks.whitespace);
+        const uint64_t nonquote_scalar = scalar & ~quote;
+        const uint64_t follows_scalar = (nonquote_scalar << 1) | m_prev_scalar;
+        m_prev_scalar = nonquote_scalar >> 63;
+
+        uint64_t structurals = masks.op | (scalar & ~follows_scalar);
+        structurals &= ~(in_string ^ quote);
+
+        // Make sure there is room for the whole block before flattening
+        if (m_count + BLOCK_SIZE > m_positions.size()) {
+            m_positions.resize(2 * m_positions.size() + BLOCK_SIZE);
+        }
+
+        uint32_t *out = m_positions.data() + m_count;
+        const size_t block_count = __builtin_popcountll(structurals);
+
+        // Write in batches of eight; excess entries are overwritten later
+        for (size_t i = 0; i < block_count; i += 8) {
+            for (size_t j = 0; j < 8; ++j) {
+                const auto bit = __builtin_ctzll(structurals | HIGH_BIT);
+                out[i + j] = static_cast<uint32_t>(offset + bit);
+                structurals &= structurals - 1;
+            }
+        }
+
+        m_count += block_count;
+    }
+
+    void finish() {
+        m_positions.resize(m_count);
+
+        if (m_prev_in_string != 0) {
+            throw json_parse_error(ParseErrorCode::UnexpectedEnd,
+                                   "String not terminated!");
+        }
+    }
+
+  private:
+    std::vector<uint32_t> &m_positions;
+    size_t m_count = 0;
+
+    uint64_t m_prev_escaped = 0;
+    uint64_t m_prev_in_string = 0;
+    uint64_t m_prev_scalar = 0;
+};
+
+inline void classify_scalar(const uint8_t *block, block_masks &masks) {
+    masks = {0, 0, 0, 0};
+
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const uint64_t cls = CLASS_TABLE.entries[block[i]];
+
+        masks.quote |= (cls & CLASS_QUOTE) << i;
+        masks.backslash |= ((cls & CLASS_BACKSLASH) >> 1) << i;
+        masks.op |= ((cls & CLASS_OP) >> 2) << i;
+        masks.whitespace |= ((cls & CLASS_WHITESPACE) >> 3) << i;
+    }
+}
+
+/**
+ * Check the UTF-8 of [checked, end) and move checked past it
+ *
+ * A sequence that is cut off by the end of a window is checked again with the
+ * next one.
+ */
+void check_utf8_scalar(const uint8_t *input, size_t length, size_t end,
+                       size_t &checked) {
+    const size_t invalid =
+        checked + find_invalid_utf8(input + checked, end - checked);
+
+    if (invalid == end) {
+        checked = end;
+    } else if (end < length && end - invalid < 4) {
+        checked = invalid;
+    } else {
+        throw_invalid_utf8(invalid);
+    }
+}
+
+/*
+ * The kernels index the blocks from begin up to end, which is either a
+ * multiple of the block size or the end of the input
+ */
+void index_scalar(const uint8_t *input, size_t length, size_t begin,
+                  size_t end, bool validate_utf8, size_t &utf8_checked,
+                  block_indexer &indexer) {
+    if (validate_utf8) {
+        check_utf8_scalar(input, length, end, utf8_checked);
+    }
+
+    uint8_t tail[BLOCK_SIZE];
+
+    for (size_t offset = begin; offset < end; offset += BLOCK_SIZE) {
+        block_masks masks;
+        classify_scalar(block_indexer::load_block(input, length, offset, tail),
+                        masks);
+        indexer.add_block(masks, offset);
+    }
+}
+
+#ifdef JSON_X86_KERNELS
+/*
+ * UTF-8 validation with vector lookups, following "Validating UTF-8 In Less
+ * Than One Instruction Per Byte" (Keiser and Lemire)
+ *
+ * Every byte is checked together with the one before it using three 16-entry
+ * tables, indexed by the high and low nibble of the previous byte and the high
+ * nibble of the current one. Each bit stands for one kind of error and is only
+ * set in all three tables if that error occurs. The third and fourth byte of a
+ * sequence are checked by looking back two and three bytes.
+ */
+constexpr uint8_t TOO_SHORT = 1 << 0;
+constexpr uint8_t TOO_LONG = 1 << 1;
+constexpr uint8_t OVERLONG_3 = 1 << 2;
+constexpr uint8_t TOO_LARGE = 1 << 3;
+constexpr uint8_t SURROGATE = 1 << 4;
+constexpr uint8_t OVERLONG_2 = 1 << 5;
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+constexpr uint8_t OVERLONG_4 = 1 << 6;
+constexpr uint8_t TWO_CONTS = 1 << 7;
+
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+alignas(16) constexpr uint8_t UTF8_BYTE_1_HIGH[16] = {
+    // ASCII
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG,
+    // Continuation
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    // Leads of two, three and four bytes
+    TOO_SHORT | OVERLONG_2, TOO_SHORT, TOO_SHORT | OVERLONG_3 | SURROGATE,
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4};
+
+alignas(16) constexpr uint8_t UTF8_BYTE_1_LOW[16] = {
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    CARRY | OVERLONG_2,
+    CARRY,
+    CARRY,
+    CARRY | TOO_LARGE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000};
+
+alignas(16) constexpr uint8_t UTF8_BYTE_2_HIGH[16] = {
+    // ASCII
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT,
+    // Continuation
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+        OVERLONG_4,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    // Leads
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT};
+
+/// A sequence is incomplete if one of the last three bytes exceeds this
+alignas(32) constexpr uint8_t UTF8_MAX_COMPLETE[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF};
+
+/**
+ * Validation state that is carried from one block to the next
+ */
+struct utf8_sse42 {
+    __m128i error{};
+    __m128i prev_input{};
+    __m128i prev_incomplete{};
+
+    __attribute__((target("sse4.2"))) void reset() {
+        error = prev_input = prev_incomplete = _mm_setzero_si128();
+    }
+
+    __attribute__((target("sse4.2"))) void check(__m128i input) {
+        const __m128i low_nibble = _mm_set1_epi8(0x0F);
+
+        const __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+        const __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+        const __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+
+        const __m128i byte_1_high = _mm_shuffle_epi8(
+            load(UTF8_BYTE_1_HIGH),
+            _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+        const __m128i byte_1_low = _mm_shuffle_epi8(
+            load(UTF8_BYTE_1_LOW), _mm_and_si128(prev1, low_nibble));
+        const __m128i byte_2_high = _mm_shuffle_epi8(
+            load(UTF8_BYTE_2_HIGH),
+            _mm_and_si128(_mm_srli_epi16(input, 4), low_nibble));
+
+        const __m128i special = _mm_and_si128(
+            _mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+        // Third and fourth bytes have to be continuations
+        const __m128i is_third = _mm_subs_epu8(prev2, _mm_set1_epi8(0x60));
+        const __m128i is_fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(0x70));
+        const __m128i must_be_cont =
+            _mm_and_si128(_mm_or_si128(is_third, is_fourth),
+                          _mm_set1_epi8(static_cast<char>(0x80)));
+
+        error = _mm_or_si128(error, _mm_xor_si128(must_be_cont, special));
+        prev_input = input;
+    }
+
+    /**
+     * \returns false if the input is not valid UTF-8 so far
+     */
+    __attribute__((target("sse4.2"))) bool check_block(const uint8_t *block) {
+        __m128i chunks[BLOCK_SIZE / 16];
+        __m128i any = _mm_setzero_si128();
+
+        for (size_t i = 0; i < BLOCK_SIZE / 16; ++i) {
+            chunks[i] = load(block + i * 16);
+            any = _mm_or_si128(any, chunks[i]);
+        }
+
+        if (_mm_movemask_epi8(any) == 0) {
+            // Only a sequence of the previous block can be wrong
+            error = _mm_or_si128(error, prev_incomplete);
+            prev_incomplete = _mm_setzero_si128();
+            prev_input = chunks[BLOCK_SIZE / 16 - 1];
+        } else {
+            for (auto chunk : chunks) {
+                check(chunk);
+            }
+
+            prev_incomplete =
+                _mm_subs_epu8(prev_input, load(UTF8_MAX_COMPLETE + 16));
+        }
+
+        return _mm_testz_si128(error, error);
+    }
+
+    /**
+     * \returns false if the input ended inside of a sequence
+     */
+    __attribute__((target("sse4.2"))) bool finish() {
+        error = _mm_or_si128(error, prev_incomplete);
+        return _mm_testz_si128(error, error);
+    }
+
+    __attribute__((target("sse4.2"))) static __m128i load(const uint8_t *p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+};
+
+struct utf8_avx2 {
+    __m256i error{};
+    __m256i prev_input{};
+    __m256i prev_incomplete{};
+
+    __attribute__((target("avx2"))) void reset() {
+        error = prev_input = prev_incomplete = _mm256_setzero_si256();
+    }
+
+    __attribute__((target("avx2"))) void check(__m256i input) {
+        const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+
+        // Lanes are shifted separately, so bring in the end of the other one
+        const __m256i shifted =
+            _mm256_permute2x128_si256(prev_input, input, 0x21);
+        const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+        const __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+        const __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+
+        const __m256i byte_1_high = _mm256_shuffle_epi8(
+            table(UTF8_BYTE_1_HIGH),
+            _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+        const __m256i byte_1_low = _mm256_shuffle_epi8(
+            table(UTF8_BYTE_1_LOW), _mm256_and_si256(prev1, low_nibble));
+        const __m256i byte_2_high = _mm256_shuffle_epi8(
+            table(UTF8_BYTE_2_HIGH),
+            _mm256_and_si256(_mm256_srli_epi16(input, 4), low_nibble));
+
+        const __m256i special = _mm256_and_si256(
+            _mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+        const __m256i is_third =
+            _mm256_subs_epu8(prev2, _mm256_set1_epi8(0x60));
+        const __m256i is_fourth =
+            _mm256_subs_epu8(prev3, _mm256_set1_epi8(0x70));
+        const __m256i must_be_cont =
+            _mm256_and_si256(_mm256_or_si256(is_third, is_fourth),
+                             _mm256_set1_epi8(static_cast<char>(0x80)));
+
+        error =
+            _mm256_or_si256(error, _mm256_xor_si256(must_be_cont, special));
+        prev_input = input;
+    }
+
+    __attribute__((target("avx2"))) bool check_block(const uint8_t *block) {
+        const __m256i first =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+        const __m256i second =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + 32));
+
+        if (_mm256_movemask_epi8(_mm256_or_si256(first, second)) == 0) {
+            error = _mm256_or_si256(error, prev_incomplete);
+            prev_incomplete = _mm256_setzero_si256();
+            prev_input = second;
+        } else {
+            check(first);
+            check(second);
+
+            prev_incomplete = _mm256_subs_epu8(
+                second, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(
+                            UTF8_MAX_COMPLETE)));
+        }
+
+        return _mm256_testz_si256(error, error);
+    }
+
+    __attribute__((target("avx2"))) bool finish() {
+        error = _mm256_or_si256(error, prev_incomplete);
+        return _mm256_testz_si256(error, error);
+    }
+
+    /**
+     * Repeat a 16-entry table in both lanes
+     */
+    __attribute__((target("avx2"))) static __m256i table(const uint8_t *p) {
+        return _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    }
+};
+
+__attribute__((target("sse4.2"))) inline void
+classify_sse42(const uint8_t *block, block_masks &masks) {
+    constexpr int MODE =
+        _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK;
+
+    const __m128i ops = _mm_setr_epi8('{', '}', '[', ']', ':', ',', 0, 0, 0,
+                                      0, 0, 0, 0, 0, 0, 0);
+    const __m128i spaces = _mm_setr_epi8(' ', '\t', '\n', '\r', 0, 0, 0, 0, 0,
+                                         0, 0, 0, 0, 0, 0, 0);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    masks = {0, 0, 0, 0};
+
+    for (size_t i = 0; i < BLOCK_SIZE / 16; ++i) {
+        const __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i * 16));
+        const auto shift = i * 16;
+
+        const uint64_t quote_bits = static_cast<uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)));
+        const uint64_t backslash_bits = static_cast<uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)));
+        const uint64_t op_bits = static_cast<uint16_t>(
+            _mm_cvtsi128_si32(_mm_cmpestrm(ops, 6, chunk, 16, MODE)));
+        const uint64_t space_bits = static_cast<uint16_t>(
+            _mm_cvtsi128_si32(_mm_cmpestrm(spaces, 4, chunk, 16, MODE)));
+
+        masks.quote |= quote_bits << shift;
+        masks.backslash |= backslash_bits << shift;
+        masks.op |= op_bits << shift;
+        masks.whitespace |= space_bits << shift;
+    }
+}
+
+template <bool ValidateUtf8>
+__attribute__((target("sse4.2,popcnt"))) void
+index_sse42(const uint8_t *input, size_t length, size_t begin, size_t end,
+           utf8_sse42 &utf8, block_indexer &indexer) {
+    uint8_t tail[BLOCK_SIZE];
+
+    for (size_t offset = begin; offset < end; offset += BLOCK_SIZE) {
+        const auto *block =
+            block_indexer::load_block(input, length, offset, tail);
+
+        if constexpr (ValidateUtf8) {
+            // Only whole blocks are checked, so look for the exact byte
+            // with the scalar code; the error is at or before this block
+            if (!utf8.check_block(block)) {
+                throw_invalid_utf8(find_invalid_utf8(
+                    input, std::min(length, offset + BLOCK_SIZE)));
+            }
+        }
+
+        block_masks masks;
+        classify_sse42(block, masks);
+        indexer.add_block(masks, offset);
+    }
+
+    if constexpr (ValidateUtf8) {
+        if (end == length && !utf8.finish()) {
+            throw_invalid_utf8(find_invalid_utf8(input, length));
+        }
+    }
+}
+
+__attribute__((target("avx2"))) inline void
+classify_avx2(const uint8_t *block, block_masks &masks) {
+    // Lookup tables indexed by the lower nibble of each byte
+    const __m256i space_table = _mm256_setr_epi8(
+        ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r',
+        100, 100, ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112,
+        100, '\r', 100, 100);
+    const __m256i op_table = _mm256_setr_epi8(
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0);
+
+    masks = {0, 0, 0, 0};
+
+    for (size_t i = 0; i < BLOCK_SIZE / 32; ++i) {
+        const __m256i chunk = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(block + i * 32));
+        const auto shift = i * 32;
+
+        const __m256i quote = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'));
+        const __m256i backslash =
+            _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'));
+        const __m256i space =
+            _mm256_cmpeq_epi8(chunk, _mm256_shuffle_epi8(space_table, chunk));
+
+        // Brackets only differ from braces in bit 0x20; control characters
+        // would alias with the operators otherwise
+        const __m256i curly = _mm256_or_si256(chunk, _mm256_set1_epi8(0x20));
+        const __m256i printable =
+            _mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(0x1F));
+        const __m256i op = _mm256_and_si256(
+            _mm256_cmpeq_epi8(curly, _mm256_shuffle_epi8(op_table, chunk)),
+            printable);
+
+        auto to_mask = [](int bits) -> uint64_t {
+            return static_cast<uint32_t>(bits);
+        };
+
+        masks.quote |= to_mask(_mm256_movemask_epi8(quote)) << shift;
+        masks.backslash |= to_mask(_mm256_movemask_epi8(backslash)) << shift;
+        masks.op |= to_mask(_mm256_movemask_epi8(op)) << shift;
+        masks.whitespace |= to_mask(_mm256_movemask_epi8(space)) << shift;
+    }
+}
+
+template <bool ValidateUtf8>
+__attribute__((target("avx2,bmi,popcnt"))) void
+index_avx2(const uint8_t *input, size_t length, size_t begin, size_t end,
+           utf8_avx2 &utf8, block_indexer &indexer) {
+    uint8_t tail[BLOCK_SIZE];
+
+    for (size_t offset = begin; offset < end; offset += BLOCK_SIZE) {
+        const auto *block =
+            block_indexer::load_block(input, length, offset, tail);
+
+        if constexpr (ValidateUtf8) {
+            // Only whole blocks are checked, so look for the exact byte
+            // with the scalar code; the error is at or before this block
+            if (!utf8.check_block(block)) {
+                throw_invalid_utf8(find_invalid_utf8(
+                    input, std::min(length, offset + BLOCK_SIZE)));
+            }
+        }
+
+        block_masks masks;
+        classify_avx2(block, masks);
+        indexer.add_block(masks, offset);
+    }
+
+    if constexpr (ValidateUtf8) {
+        if (end == length && !utf8.finish()) {
+            throw_invalid_utf8(find_invalid_utf8(input, length));
+        }
+    }
+}
+#endif
+
+} // namespace
+
+bool StructuralIndex::kernel_supported(IndexKernel kernel) {
+    switch (kernel) {
+    case IndexKernel::Scalar:
+    case IndexKernel::Best:
+        return true;
+#ifdef JSON_X86_KERNELS
+    case IndexKernel::SSE42:
+        return __builtin_cpu_supports("sse4.2") &&
+               __builtin_cpu_supports("popcnt");
+    case IndexKernel::AVX2:
+        return __builtin_cpu_supports("avx2") &&
+               __builtin_cpu_supports("bmi") &&
+               __builtin_cpu_supports("popcnt");
+#endif
+    default:
+        return false;
+    }
+}
+
+IndexKernel StructuralIndex::best_kernel() {
+    static const IndexKernel best = []() {
+        if (kernel_supported(IndexKernel::AVX2)) {
+            return IndexKernel::AVX2;
+        } else if (kernel_supported(IndexKernel::SSE42)) {
+            return IndexKernel::SSE42;
+        } else {
+            return IndexKernel::Scalar;
+        }
+    }();
+
+    return best;
+}
+
+/**
+ * Where indexing stopped and what is carried over to the next window
+ *
+ * This is kept between inputs, so that indexing does not allocate.
+ */
+struct StructuralIndex::state {
+    explicit state(std::vector<uint32_t> &positions) : indexer(positions) {}
+
+    const uint8_t *input = nullptr;
+    size_t length = 0;
+
+    /// Everything before this has been indexed
+    size_t offset = 0;
+
+    IndexKernel kernel = IndexKernel::Scalar;
+    bool validate_utf8 = false;
+
+    /// The scalar kernel has validated the UTF-8 up to here
+    size_t utf8_checked = 0;
+
+    block_indexer indexer;
+
+#ifdef JSON_X86_KERNELS
+    utf8_sse42 sse42;
+    utf8_avx2 avx2;
+#endif
+};
+
+StructuralIndex::StructuralIndex() = default;
+
+StructuralIndex::~StructuralIndex() = default;
+
+void StructuralIndex::build(const char *data, size_t length,
+                            IndexKernel kernel, bool validate_utf8) {
+    start(data, length, kernel, validate_utf8);
+
+    if (!m_complete) {
+        index_until(length);
+    }
+}
+
+void StructuralIndex::start(const char *data, size_t length,
+                            IndexKernel kernel, bool validate_utf8) {
+    if (length > std::numeric_limits<uint32_t>::max()) {
+        throw json_parse_error(ParseErrorCode::InputTooLarge,
+                               "Input is too large");
+    }
+
+    if (kernel == IndexKernel::Best) {
+        kernel = best_kernel();
+    }
+
+    if (!m_state) {
+        m_state = std::make_unique<state>(m_positions);
+    }
+
+    auto &s = *m_state;
+    s.input = reinterpret_cast<const uint8_t *>(data);
+    s.length = length;
+    s.offset = 0;
+    s.kernel = kernel;
+    s.validate_utf8 = validate_utf8;
+    s.utf8_checked = 0;
+    s.indexer.reset();
+
+#ifdef JSON_X86_KERNELS
+    if (kernel == IndexKernel::AVX2) {
+        s.avx2.reset();
+    } else if (kernel == IndexKernel::SSE42) {
+        s.sse42.reset();
+    }
+#endif
+
+    m_size = 0;
+    m_complete = length == 0;
+}
+
+bool StructuralIndex::index_more() {
+    if (m_complete) {
+        return false;
+    }
+
+    index_until(m_state->offset + INDEX_WINDOW_SIZE);
+    return true;
+}
+
+void StructuralIndex::index_until(size_t end) {
+    auto &s = *m_state;
+    end = std::min(end, s.length);
+
+    // Stays set if indexing fails, so the window is not indexed again
+    m_complete = true;
+
+    switch (s.kernel) {
+#ifdef JSON_X86_KERNELS
+    case IndexKernel::AVX2:
+        if (s.validate_utf8) {
+            index_avx2<true>(s.input, s.length, s.offset, end, s.avx2,
+                             s.indexer);
+        } else {
+            index_avx2<false>(s.input, s.length, s.offset, end, s.avx2,
+                              s.indexer);
+        }
+        break;
+    case IndexKernel::SSE42:
+        if (s.validate_utf8) {
+            index_sse42<true>(s.input, s.length, s.offset, end, s.sse42,
+                              s.indexer);
+        } else {
+            index_sse42<false>(s.input, s.length, s.offset, end, s.sse42,
+                               s.indexer);
+        }
+        break;
+#endif
+    case IndexKernel::Scalar:
+        index_scalar(s.input, s.length, s.offset, end, s.validate_utf8,
+                     s.utf8_checked, s.indexer);
+        break;
+    default:
+        throw json_error("Structural index kernel is not available");
+    }
+
+    s.offset = end;
+
+    if (end == s.length) {
+        s.indexer.finish();
+    } else {
+        m_complete = false;
+    }
+
+    m_size = s.indexer.count();
+}
+
+} // namespace json
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace json {
+
+/**
+ * Vector instruction sets the structural indexer can use
+ */
+enum class IndexKernel { Scalar, SSE42, AVX2, Best };
+
+/**
+ * Bytes of input that StructuralIndex::index_more() looks at in one go
+ */
+constexpr size_t INDEX_WINDOW_SIZE = 64 * 1024;
+
+/**
+ * First stage of the JSON text parser
+ *
+ * Records the position of every structural character ({}[]:,), every opening
+ * quote and the first byte of every other value (numbers, literals,
+ * datetimes). Whitespace and the contents of strings are skipped. Input is
+ * processed in blocks of 64 bytes using the fastest kernel the CPU supports.
+ *
+ * The index can either be built for the whole input at once, or window by
+ * window while it is being parsed, so that an error close to the start of a
+ * large input is found without scanning all of it.
+ */
+class StructuralIndex {
+  public:
+    StructuralIndex();
+    ~StructuralIndex();
+
+    /**
+     * Scan the input and build the index
+     *
+     * \param validate_utf8
+     *      Also make sure the whole input is valid UTF-8. The vector kernels
+     *      check each block while it is being classified.
+     * \throws json_error if the input ends inside a string or is not valid
+     *         UTF-8
+     */
+    void build(const char *data, size_t length,
+               IndexKernel kernel = IndexKernel::Best,
+               bool validate_utf8 = false);
+
+    /**
+     * Prepare to index the input one window at a time
+     *
+     * The index is empty until index_more() is called. The input is not
+     * copied and must outlive the index.
+     *
+     * \throws json_error if the input is too large
+     */
+    void start(const char *data, size_t length,
+               IndexKernel kernel = IndexKernel::Best,
+               bool validate_utf8 = false);
+
+    /**
+     * Append the positions of the next INDEX_WINDOW_SIZE bytes of input
+     *
+     * \returns false if the whole input has been indexed already
+     * \throws json_error like build() once the error is inside of the window
+     */
+    bool index_more();
+
+    bool complete() const { return m_complete; }
+
+    /**
+     * All positions, only once the index is complete
+     */
+    const std::vector<uint32_t> &positions() const { return m_positions; }
+
+    size_t size() const { return m_size; }
+
+    uint32_t operator[](size_t i) const { return m_positions[i]; }
+
+    /**
+     * Is this kernel supported by the CPU we are running on?
+     */
+    static bool kernel_supported(IndexKernel kernel);
+
+    /**
+     * The kernel that is used for IndexKernel::Best
+     */
+    static IndexKernel best_kernel();
+
+  private:
+    /// Where indexing stopped and what is carried over to the next window
+    struct state;
+
+    void index_until(size_t end);
+
+    std::unique_ptr<state> m_state;
+    std::vector<uint32_t> m_positions;
+
+    /// Positions found so far; the vector may hold unused entries after them
+    size_t m_size = 0;
+    bool m_complete = true;
+};
+
+} // namespace json
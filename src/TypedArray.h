@@ -0,0 +1,68 @@
+#pragma once
+
+#include <bitstream.h>
+
+#include "json/defines.h"
+
+namespace json {
+
+/**
+ * Values of typed arrays start at a multiple of this from the start of the
+ * document
+ */
+constexpr uint32_t TYPED_ARRAY_ALIGNMENT = 8;
+
+/// Integers and floats take the same space
+constexpr uint32_t TYPED_ARRAY_ELEMENT_SIZE = sizeof(integer_t);
+
+static_assert(sizeof(integer_t) == sizeof(json::float_t),
+              "integer and float must have same size");
+
+/**
+ * Read the header of a typed array
+ *
+ * The view has to be placed right after the type. Afterwards, it is at the
+ * first value.
+ */
+inline void read_typed_array(bitstream &view, ObjectType &element_type,
+                             uint32_t &size) {
+    uint32_t byte_size;
+    uint8_t padding;
+    view >> byte_size >> size >> element_type >> padding;
+    view.move_by(padding);
+}
+
+/**
+ * Write a typed array, padded so that its values are aligned relative to
+ * document_start
+ */
+inline void write_typed_array(bitstream &result, uint32_t document_start,
+                              ObjectType element_type, const uint8_t *values,
+                              uint32_t size) {
+    constexpr uint32_t HEADER_SIZE =
+        2 * sizeof(ObjectType) + 2 * sizeof(uint32_t) + sizeof(uint8_t);
+
+    const uint32_t offset = result.pos() + HEADER_SIZE - document_start;
+    const auto padding = static_cast<uint8_t>(
+        (TYPED_ARRAY_ALIGNMENT - offset % TYPED_ARRAY_ALIGNMENT) %
+        TYPED_ARRAY_ALIGNMENT);
+
+    const uint32_t data_size = size * TYPED_ARRAY_ELEMENT_SIZE;
+    const uint32_t byte_size = HEADER_SIZE - sizeof(ObjectType) -
+                               sizeof(uint32_t) + padding + data_size;
+
+    result << ObjectType::TypedArray << byte_size << size << element_type
+           << padding;
+
+    if (padding > 0) {
+        const uint64_t zero = 0;
+        result.write_raw_data(reinterpret_cast<const uint8_t *>(&zero),
+                              padding);
+    }
+
+    if (data_size > 0) {
+        result.write_raw_data(values, data_size);
+    }
+}
+
+} // namespace json
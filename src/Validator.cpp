@@ -0,0 +1,359 @@
+#include "Validator.h"
+#include "KeyDictionary.h"
+#include "TypedArray.h"
+
+#include <cstring>
+#include <ctime>
+#include <string_view>
+
+#ifdef USE_GEO
+#include "geo/vector2.h"
+#endif
+
+namespace json {
+
+namespace {
+
+/**
+ * Orders the entries of a key table like the Writer does
+ */
+inline bool entry_less(std::string_view key1, uint32_t offset1,
+                       std::string_view key2, uint32_t offset2) {
+    const int cmp = key1.compare(key2);
+    return cmp < 0 || (cmp == 0 && offset1 < offset2);
+}
+
+} // namespace
+
+bool Validator::validate() {
+    if (m_size == 0) {
+        return false;
+    }
+
+    // The document itself is the only child of the bottom frame
+    m_stack[0] = Frame{m_size, 1, 0, 0, 0, ObjectType::Array};
+    m_depth = 1;
+
+    while (m_depth > 0) {
+        Frame &frame = m_stack[m_depth - 1];
+
+        if (frame.remaining == 0) {
+            if (m_pos != frame.end) {
+                return false;
+            }
+
+            --m_depth;
+            continue;
+        }
+
+        --frame.remaining;
+
+        switch (frame.type) {
+        case ObjectType::Map:
+        case ObjectType::SortedMap: {
+            uint32_t length;
+
+            if (!read(frame.end, length) ||
+                (frame.type == ObjectType::SortedMap &&
+                 !find_in_key_table(frame, length)) ||
+                !skip(frame.end, length)) {
+                return false;
+            }
+            break;
+        }
+        case ObjectType::DictionaryMap: {
+            key_id_t id;
+
+            if (frame.end - m_pos < sizeof(id)) {
+                return false;
+            }
+
+            memcpy(&id, m_data + m_pos, sizeof(id));
+            m_pos += sizeof(id);
+
+            if (id >= frame.dictionary_size) {
+                return false;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (m_pos == frame.end) {
+            return false;
+        }
+
+        const auto type = static_cast<ObjectType>(m_data[m_pos++]);
+        uint32_t length;
+
+        switch (type) {
+        case ObjectType::Null:
+        case ObjectType::True:
+        case ObjectType::False:
+            break;
+        case ObjectType::Integer:
+        case ObjectType::Float:
+            if (!skip(frame.end, sizeof(integer_t))) {
+                return false;
+            }
+            break;
+        case ObjectType::Datetime:
+            if (!skip(frame.end, sizeof(tm))) {
+                return false;
+            }
+            break;
+        case ObjectType::Timestamp:
+            if (!skip(frame.end, TIMESTAMP_SIZE)) {
+                return false;
+            }
+            break;
+#ifdef USE_GEO
+        case ObjectType::Vector2:
+            if (!skip(frame.end, sizeof(geo::vector2d))) {
+                return false;
+            }
+            break;
+#endif
+        case ObjectType::String:
+        case ObjectType::Binary:
+            if (!read(frame.end, length) || !skip(frame.end, length)) {
+                return false;
+            }
+            break;
+        case ObjectType::Map:
+        case ObjectType::SortedMap:
+        case ObjectType::DictionaryMap:
+        case ObjectType::Array:
+        case ObjectType::TypedArray:
+            if (!push_container(type, frame)) {
+                return false;
+            }
+            break;
+        case ObjectType::KeyDictionary:
+            if (!push_dictionary(frame)) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Validator::push_container(ObjectType type, const Frame &parent) {
+    uint32_t byte_size, size;
+
+    if (!read(parent.end, byte_size)) {
+        return false;
+    }
+
+    const uint32_t start = m_pos;
+
+    if (byte_size > parent.end - start || !read(start + byte_size, size)) {
+        return false;
+    }
+
+    const uint32_t end = start + byte_size;
+
+    if (type == ObjectType::TypedArray) {
+        uint8_t header[2];
+
+        if (end - m_pos < sizeof(header)) {
+            return false;
+        }
+
+        memcpy(header, m_data + m_pos, sizeof(header));
+        m_pos += sizeof(header);
+
+        const auto element_type = static_cast<ObjectType>(header[0]);
+        const uint8_t padding = header[1];
+
+        // Nothing but the values may follow the padding
+        if ((element_type != ObjectType::Integer &&
+             element_type != ObjectType::Float) ||
+            padding >= TYPED_ARRAY_ALIGNMENT ||
+            end - m_pos !=
+                padding + uint64_t(size) * TYPED_ARRAY_ELEMENT_SIZE) {
+            return false;
+        }
+
+        m_pos = end;
+        return true;
+    }
+
+    // Every child takes at least one byte
+    if (size > end - m_pos || m_depth == MAX_VALIDATION_DEPTH) {
+        return false;
+    }
+
+    uint32_t table = 0;
+
+    if (type == ObjectType::SortedMap) {
+        table = m_pos;
+
+        if (!skip(end, uint64_t(size) * sizeof(uint32_t)) ||
+            !check_key_table(table, size, end)) {
+            return false;
+        }
+    }
+
+    m_stack[m_depth++] =
+        Frame{end, size, parent.dictionary_size, table, size, type};
+    return true;
+}
+
+bool Validator::push_dictionary(const Frame &parent) {
+    uint32_t byte_size, size;
+
+    if (!read(parent.end, byte_size) || byte_size > parent.end - m_pos) {
+        return false;
+    }
+
+    const uint32_t end = m_pos + byte_size;
+    const uint32_t table = m_pos;
+
+    if (!read(end, size) ||
+        size > MAX_DICTIONARY_KEYS ||
+        !skip(end, uint64_t(size) * sizeof(uint32_t))) {
+        return false;
+    }
+
+    // Every key has to lie within the keys, which end where the last one does
+    const uint32_t keys = m_pos;
+    uint32_t keys_end = keys;
+
+    if (size > 0) {
+        const uint32_t last = load(keys - sizeof(uint32_t));
+        uint32_t length;
+
+        if (!skip(end, last) || !read(end, length) || !skip(end, length)) {
+            return false;
+        }
+
+        keys_end = m_pos;
+    }
+
+    for (uint32_t i = 0; i < size; ++i) {
+        const uint32_t offset = load(table + sizeof(uint32_t) * (i + 1));
+
+        if (offset > keys_end - keys ||
+            keys_end - keys - offset < sizeof(uint32_t) ||
+            load(keys + offset) >
+                keys_end - keys - offset - sizeof(uint32_t)) {
+            return false;
+        }
+    }
+
+    // The value follows the padding
+    if (!skip(end, dictionary_padding(keys_end - table)) ||
+        m_depth == MAX_VALIDATION_DEPTH) {
+        return false;
+    }
+
+    m_stack[m_depth++] = Frame{end, 1, size, 0, 0, ObjectType::KeyDictionary};
+    return true;
+}
+
+bool Validator::check_key_table(uint32_t table, uint32_t size,
+                                uint32_t end) const {
+    const uint32_t entries = table + size * sizeof(uint32_t);
+    const uint32_t entries_size = end - entries;
+
+    std::string_view previous_key;
+    uint32_t previous_offset = 0;
+
+    for (uint32_t i = 0; i < size; ++i) {
+        const uint32_t offset = load(table + i * sizeof(uint32_t));
+
+        if (offset > entries_size ||
+            entries_size - offset < sizeof(uint32_t)) {
+            return false;
+        }
+
+        const uint32_t length = load(entries + offset);
+
+        if (length > entries_size - offset - sizeof(uint32_t)) {
+            return false;
+        }
+
+        const std::string_view key(
+            reinterpret_cast<const char *>(m_data + entries + offset +
+                                           sizeof(uint32_t)),
+            length);
+
+        if (i > 0 && !entry_less(previous_key, previous_offset, key, offset)) {
+            return false;
+        }
+
+        previous_key = key;
+        previous_offset = offset;
+    }
+
+    return true;
+}
+
+bool Validator::find_in_key_table(const Frame &frame,
+                                  uint32_t key_length) const {
+    // The position is right after the length of the key
+    if (key_length > frame.end - m_pos) {
+        return false;
+    }
+
+    const uint32_t entries = frame.table + frame.size * sizeof(uint32_t);
+    const uint32_t offset = m_pos - sizeof(uint32_t) - entries;
+    const std::string_view key(reinterpret_cast<const char *>(m_data + m_pos),
+                               key_length);
+
+    // The table is ordered and holds as many offsets as there are entries, so
+    // finding every entry in it means that it holds each of them once
+    uint32_t low = 0;
+    uint32_t high = frame.size;
+
+    while (low < high) {
+        const uint32_t mid = low + (high - low) / 2;
+        const uint32_t mid_offset = load(frame.table + mid * sizeof(uint32_t));
+        const std::string_view mid_key(
+            reinterpret_cast<const char *>(m_data + entries + mid_offset +
+                                           sizeof(uint32_t)),
+            load(entries + mid_offset));
+
+        if (entry_less(mid_key, mid_offset, key, offset)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low < frame.size &&
+           load(frame.table + low * sizeof(uint32_t)) == offset;
+}
+
+bool Validator::read(uint32_t end, uint32_t &value) {
+    if (end - m_pos < sizeof(value)) {
+        return false;
+    }
+
+    value = load(m_pos);
+    m_pos += sizeof(value);
+    return true;
+}
+
+bool Validator::skip(uint32_t end, uint64_t length) {
+    if (length > end - m_pos) {
+        return false;
+    }
+
+    m_pos += length;
+    return true;
+}
+
+uint32_t Validator::load(uint32_t pos) const {
+    uint32_t value;
+    memcpy(&value, m_data + pos, sizeof(value));
+    return value;
+}
+
+} // namespace json
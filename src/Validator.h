@@ -0,0 +1,95 @@
+#pragma once
+
+#include "json/defines.h"
+
+namespace json {
+
+/**
+ * Containers and key dictionaries can only be nested this deep in a
+ * document that is validated
+ */
+constexpr uint32_t MAX_VALIDATION_DEPTH = 512;
+
+/**
+ * Checks that every part of an encoded document lies within its buffer
+ *
+ * This covers every type tag, byte size, entry count and length, the key
+ * tables of sorted maps and key dictionaries, and the key ids of dictionary
+ * maps. A document that passes can be read without leaving the buffer. The
+ * values themselves, e.g. the encoding of strings, are not checked.
+ *
+ * The document is checked in a single pass, with an explicit stack of fixed
+ * size instead of recursion, and without allocating.
+ */
+class Validator {
+  public:
+    Validator(const uint8_t *data, uint32_t size)
+        : m_data(data), m_size(size) {}
+
+    /**
+     * \returns false if the buffer does not hold exactly one valid value
+     */
+    bool validate();
+
+  private:
+    struct Frame {
+        /// Where the content of the container ends
+        uint32_t end;
+
+        /// Children that have not been visited yet
+        uint32_t remaining;
+
+        /// Number of keys in the enclosing dictionary, if any
+        uint32_t dictionary_size;
+
+        /// Where the key table of a sorted map starts
+        uint32_t table;
+
+        /// Number of entries of a sorted map
+        uint32_t size;
+
+        ObjectType type;
+    };
+
+    /**
+     * Check the header of a container at the current position and push it
+     *
+     * The position has to be right after the type. Afterwards, it is at the
+     * first child.
+     */
+    bool push_container(ObjectType type, const Frame &parent);
+
+    bool push_dictionary(const Frame &parent);
+
+    /**
+     * Check that the key table of a sorted map points to keys within the
+     * entries, ordered by key and then by offset
+     */
+    bool check_key_table(uint32_t table, uint32_t size, uint32_t end) const;
+
+    /**
+     * Check that the entry at the current position is in the key table
+     */
+    bool find_in_key_table(const Frame &frame, uint32_t key_length) const;
+
+    /**
+     * Read a uint32_t, if there are enough bytes before end
+     */
+    bool read(uint32_t end, uint32_t &value);
+
+    /**
+     * Move past length bytes, if there are enough before end
+     */
+    bool skip(uint32_t end, uint64_t length);
+
+    uint32_t load(uint32_t pos) const;
+
+    const uint8_t *m_data;
+    const uint32_t m_size;
+    uint32_t m_pos = 0;
+
+    Frame m_stack[MAX_VALIDATION_DEPTH];
+    uint32_t m_depth = 0;
+};
+
+} // namespace json
@@ -1,34 +1,60 @@
+#include "Datetime.h"
+#include "DocumentTraversal.h"
+#include "KeyDictionary.h"
+#include "TypedArray.h"
 #include "json/json.h"
 #include <stdbitstream.h>
 
+#include <algorithm>
+
 namespace json {
 
-Writer::Writer(bitstream &result) : m_result_ptr(nullptr), m_result(result) {}
+Writer::Writer(bitstream &result) : m_result_ptr(nullptr), m_result(&result) {}
 
-Writer::Writer() : m_result_ptr(new bitstream), m_result(*m_result_ptr) {}
+Writer::Writer() : m_result_ptr(new bitstream), m_result(m_result_ptr) {}
 
 Writer::~Writer() { delete m_result_ptr; }
 
+void Writer::reset(bitstream &result) {
+    m_result = &result;
+
+    // Keep the capacity of the stacks
+    while (!m_mode.empty()) {
+        m_mode.pop();
+    }
+
+    while (!m_starts.empty()) {
+        m_starts.pop();
+    }
+
+    while (!m_sizes.empty()) {
+        m_sizes.pop();
+    }
+
+    m_key_ids.clear();
+    m_keys.clear();
+}
+
 json::Document Writer::make_document() {
-    if (m_result.empty()) {
-        m_result << ObjectType::Null;
+    if (m_result->empty()) {
+        *m_result << ObjectType::Null;
     }
 
     uint8_t *data;
     uint32_t len;
-    m_result.detach(data, len);
+    m_result->detach(data, len);
 
     return json::Document(data, len, DocumentMode::ReadWrite);
 }
 
-void Writer::start_array(const std::string &key) {
+void Writer::start_array(std::string_view key) {
     handle_key(key);
 
-    m_result << ObjectType::Array;
+    *m_result << ObjectType::Array;
 
-    uint32_t start_pos = m_result.pos();
+    uint32_t start_pos = m_result->pos();
     uint32_t byte_size = 0, size = 0;
-    m_result << byte_size << size;
+    *m_result << byte_size << size;
 
     m_starts.push(start_pos);
     m_sizes.push(size);
@@ -36,14 +62,14 @@ void Writer::start_array(const std::string &key) {
 }
 
 void Writer::end_array() {
-    uint32_t end_pos = m_result.pos();
+    uint32_t end_pos = m_result->pos();
     uint32_t start_pos = m_starts.top();
-    m_result.move_to(start_pos);
+    m_result->move_to(start_pos);
     uint32_t byte_size = end_pos - (start_pos + sizeof(uint32_t));
     uint32_t size = m_sizes.top();
 
-    m_result << byte_size << size;
-    m_result.move_to(end_pos);
+    *m_result << byte_size << size;
+    m_result->move_to(end_pos);
 
     if (m_mode.empty() || m_mode.top() != IN_ARRAY) {
         throw json_error("Writer::end_array failed: Invalid state");
@@ -56,15 +82,19 @@ void Writer::end_array() {
     check_end();
 }
 
-void Writer::start_map(const std::string &key) {
+void Writer::start_map(std::string_view key) {
     handle_key(key);
 
-    m_result << ObjectType::Map;
+    if (m_use_key_dictionary) {
+        *m_result << ObjectType::DictionaryMap;
+    } else {
+        *m_result << ObjectType::Map;
+    }
 
-    uint32_t start = m_result.pos();
+    uint32_t start = m_result->pos();
     uint32_t byte_size = 0, size = 0;
-    m_result << byte_size;
-    m_result << size;
+    *m_result << byte_size;
+    *m_result << size;
 
     m_mode.push(IN_MAP);
     m_sizes.push(size);
@@ -72,20 +102,31 @@ void Writer::start_map(const std::string &key) {
 }
 
 void Writer::end_map() {
-    uint32_t end_pos = m_result.pos();
+    finish_map(m_sorted_map_threshold > 0 &&
+               m_sizes.top() >= m_sorted_map_threshold);
+}
+
+void Writer::end_sorted_map() { finish_map(true); }
+
+void Writer::finish_map(bool sorted) {
+    uint32_t end_pos = m_result->pos();
     uint32_t start_pos = m_starts.top();
     uint32_t size = m_sizes.top();
-    m_result.move_to(start_pos);
+    m_result->move_to(start_pos);
     uint32_t byte_size = (end_pos - (start_pos + sizeof(uint32_t)));
 
-    m_result << byte_size << size;
+    *m_result << byte_size << size;
 
-    m_result.move_to(end_pos);
+    m_result->move_to(end_pos);
 
     if (m_mode.empty() || m_mode.top() != IN_MAP) {
         throw json_error("Writer::end_map failed: Invalid state");
     }
 
+    if (sorted && !m_use_key_dictionary) {
+        sort_map(start_pos, size);
+    }
+
     m_sizes.pop();
     m_starts.pop();
     m_mode.pop();
@@ -93,79 +134,256 @@ void Writer::end_map() {
     check_end();
 }
 
+void Writer::sort_map(uint32_t start_pos, uint32_t size) {
+    const uint32_t entries_pos = start_pos + 2 * sizeof(uint32_t);
+    const uint32_t end_pos = m_result->pos();
+
+    m_key_offsets.clear();
+    m_result->move_to(entries_pos);
+
+    for (uint32_t i = 0; i < size; ++i) {
+        m_key_offsets.push_back(m_result->pos() - entries_pos);
+
+        uint32_t key_size;
+        *m_result >> key_size;
+        m_result->move_by(key_size);
+
+        ObjectType type;
+        *m_result >> type;
+        DocumentTraversal::skip_next(type, *m_result);
+    }
+
+    const uint8_t *entries = m_result->data() + entries_pos;
+
+    auto key_at = [entries](uint32_t offset) {
+        uint32_t length;
+        memcpy(&length, entries + offset, sizeof(length));
+        return std::string_view(
+            reinterpret_cast<const char *>(entries + offset + sizeof(length)),
+            length);
+    };
+
+    // Keep duplicate keys in order, so lookups find the last one
+    std::stable_sort(m_key_offsets.begin(), m_key_offsets.end(),
+                     [&](uint32_t a, uint32_t b) {
+                         return key_at(a) < key_at(b);
+                     });
+
+    const uint32_t table_size = size * sizeof(uint32_t);
+
+    m_result->move_to(entries_pos);
+    m_result->make_space(table_size);
+    m_result->write_raw_data(
+        reinterpret_cast<const uint8_t *>(m_key_offsets.data()), table_size);
+
+    m_result->move_to(start_pos - sizeof(ObjectType));
+    *m_result << ObjectType::SortedMap
+              << static_cast<uint32_t>(end_pos + table_size - start_pos -
+                                       sizeof(uint32_t));
+
+    m_result->move_to(end_pos + table_size);
+}
+
+key_id_t Writer::key_id(std::string_view key) {
+    auto it = m_key_ids.find(key);
+
+    if (it != m_key_ids.end()) {
+        return it->second;
+    }
+
+    if (m_keys.size() >= MAX_DICTIONARY_KEYS) {
+        throw json_error("Too many distinct keys for a key dictionary");
+    }
+
+    const auto id = static_cast<key_id_t>(m_keys.size());
+    m_key_ids.emplace(m_keys.emplace_back(key), id);
+
+    return id;
+}
+
+void Writer::write_key_dictionary() {
+    const uint32_t end_pos = m_result->pos();
+    const auto count = static_cast<uint32_t>(m_keys.size());
+
+    uint32_t table_size = sizeof(count) + count * sizeof(uint32_t);
+
+    for (auto &key : m_keys) {
+        table_size += sizeof(uint32_t) + key.size();
+    }
+
+    const uint32_t padding = dictionary_padding(table_size);
+    table_size += padding;
+
+    const uint32_t header_size =
+        sizeof(ObjectType) + sizeof(uint32_t) + table_size;
+
+    m_result->move_to(m_document_start);
+    m_result->make_space(header_size);
+
+    *m_result << ObjectType::KeyDictionary
+              << static_cast<uint32_t>(table_size + end_pos - m_document_start)
+              << count;
+
+    uint32_t offset = 0;
+
+    for (auto &key : m_keys) {
+        *m_result << offset;
+        offset += sizeof(uint32_t) + key.size();
+    }
+
+    for (auto &key : m_keys) {
+        *m_result << static_cast<uint32_t>(key.size());
+        m_result->write_raw_data(
+            reinterpret_cast<const uint8_t *>(key.data()), key.size());
+    }
+
+    for (uint32_t i = 0; i < padding; ++i) {
+        *m_result << static_cast<uint8_t>(0);
+    }
+
+    m_result->move_to(end_pos + header_size);
+}
+
 void Writer::check_end() {
     if (m_mode.empty()) {
+        if (m_use_key_dictionary && !m_keys.empty()) {
+            write_key_dictionary();
+        }
+
         m_mode.push(DONE);
     }
 }
 
-void Writer::write_raw_data(const std::string &key, const uint8_t *data,
+void Writer::discard_value(uint32_t start) {
+    if (m_mode.empty()) {
+        throw json_error("Writer::discard_value failed: Invalid state");
+    }
+
+    m_result->move_to(start);
+    m_result->remove_space(m_result->size() - start);
+
+    if (m_mode.top() == DONE) {
+        // The whole document was taken back
+        m_mode.pop();
+    } else {
+        m_sizes.top() -= 1;
+    }
+}
+
+void Writer::write_raw_data(std::string_view key, const uint8_t *data,
                             uint32_t size) {
+    if (size > 0 &&
+        static_cast<ObjectType>(data[0]) == ObjectType::TypedArray) {
+        // The values need new padding at their new position
+        bitstream view;
+        view.assign(data, size, true);
+
+        ObjectType type, element_type;
+        uint32_t count;
+        view >> type;
+        read_typed_array(view, element_type, count);
+
+        write_typed_array(key, element_type, view.current(), count);
+        return;
+    }
+
+    handle_key(key);
+    m_result->write_raw_data(data, size);
+    check_end();
+}
+
+void Writer::write_integers(std::string_view key,
+                            std::span<const integer_t> values) {
+    write_typed_array(key, ObjectType::Integer,
+                      reinterpret_cast<const uint8_t *>(values.data()),
+                      values.size());
+}
+
+void Writer::write_floats(std::string_view key,
+                          std::span<const float_t> values) {
+    write_typed_array(key, ObjectType::Float,
+                      reinterpret_cast<const uint8_t *>(values.data()),
+                      values.size());
+}
+
+void Writer::write_typed_array(std::string_view key, ObjectType element_type,
+                               const uint8_t *values, size_t size) {
+    if (size > UINT32_MAX / TYPED_ARRAY_ELEMENT_SIZE) {
+        throw json_error("Typed array is too large");
+    }
+
     handle_key(key);
-    m_result.write_raw_data(data, size);
+    json::write_typed_array(*m_result, m_document_start, element_type, values,
+                            size);
     check_end();
 }
 
-void Writer::write_binary(const std::string &key, const bitstream &value) {
+void Writer::write_binary(std::string_view key, const bitstream &value) {
     handle_key(key);
-    m_result << ObjectType::Binary << static_cast<uint32_t>(value.size());
-    m_result.write_raw_data(value.data(), value.size());
+    *m_result << ObjectType::Binary << static_cast<uint32_t>(value.size());
+    m_result->write_raw_data(value.data(), value.size());
 }
 
 #ifdef USE_GEO
-void Writer::write_vector2(const std::string &key, const geo::vector2d &vec) {
+void Writer::write_vector2(std::string_view key, const geo::vector2d &vec) {
     handle_key(key);
-    m_result << ObjectType::Vector2 << vec.X << vec.Y;
+    *m_result << ObjectType::Vector2 << vec.X << vec.Y;
     check_end();
 }
 #endif
 
-void Writer::write_float(const std::string &key, const double &value) {
+void Writer::write_float(std::string_view key, const double &value) {
     handle_key(key);
-    m_result << ObjectType::Float << value;
+    *m_result << ObjectType::Float << value;
     check_end();
 }
 
-void Writer::write_integer(const std::string &key, const integer_t &value) {
+void Writer::write_integer(std::string_view key, const integer_t &value) {
     handle_key(key);
-    m_result << ObjectType::Integer << value;
+    *m_result << ObjectType::Integer << value;
     check_end();
 }
 
-void Writer::write_boolean(const std::string &key, const bool value) {
+void Writer::write_boolean(std::string_view key, const bool value) {
     handle_key(key);
 
     if (value) {
-        m_result << ObjectType::True;
+        *m_result << ObjectType::True;
     } else {
-        m_result << ObjectType::False;
+        *m_result << ObjectType::False;
     }
 
     check_end();
 }
 
-void Writer::write_null(const std::string &key) {
+void Writer::write_null(std::string_view key) {
     handle_key(key);
-    m_result << ObjectType::Null;
+    *m_result << ObjectType::Null;
     check_end();
 }
 
-void Writer::write_datetime(const std::string &key, const tm &value) {
+void Writer::write_datetime(std::string_view key, const tm &value) {
+    write_timestamp(key, to_timestamp(value));
+}
+
+void Writer::write_timestamp(std::string_view key, const timestamp_t &value) {
     handle_key(key);
-    m_result << ObjectType::Datetime;
-    m_result << value;
+    *m_result << ObjectType::Timestamp << value.micros << value.utc_offset;
     check_end();
 }
 
-void Writer::write_string(const std::string &key, const std::string &value) {
+void Writer::write_string(std::string_view key, std::string_view value) {
     handle_key(key);
-    m_result << ObjectType::String << value;
+    *m_result << ObjectType::String << static_cast<uint32_t>(value.size());
+    m_result->write_raw_data(reinterpret_cast<const uint8_t *>(value.data()),
+                            value.size());
     check_end();
 }
 
-void Writer::handle_key(const std::string &key) {
+void Writer::handle_key(std::string_view key) {
     if (key.empty()) {
         if (m_mode.empty()) {
+            m_document_start = m_result->pos();
             return;
         } else if (m_mode.top() != IN_ARRAY) {
             throw json_error(
@@ -186,8 +404,12 @@ void Writer::handle_key(const std::string &key) {
     m_sizes.pop();
     m_sizes.push(size + 1);
 
-    if (m_mode.top() == IN_MAP) {
-        m_result << key;
+    if (m_mode.top() == IN_MAP && m_use_key_dictionary) {
+        *m_result << key_id(key);
+    } else if (m_mode.top() == IN_MAP) {
+        *m_result << static_cast<uint32_t>(key.size());
+        m_result->write_raw_data(
+            reinterpret_cast<const uint8_t *>(key.data()), key.size());
     }
 }
 
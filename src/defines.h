@@ -1,3 +1,5 @@
+#pragma once
+
 #include <string>
 
 inline uint8_t from_hex(char c) {
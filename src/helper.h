@@ -4,6 +4,8 @@
 #include <string>
 
 #include "DocumentTraversal.h"
+#include "KeyDictionary.h"
+#include "TypedArray.h"
 #include "json.h"
 #include "json/Document.h"
 #include "json/json_error.h"
@@ -82,8 +84,49 @@ class DocumentDiffs : public DocumentTraversal {
                 }
                 break;
             }
+            case ObjectType::Timestamp: {
+                timestamp_t t1, t2;
+                view1 >> t1.micros >> t1.utc_offset;
+                view2 >> t2.micros >> t2.utc_offset;
+
+                uint32_t end = view2.pos();
+
+                if (!inside_diff && (t1.micros != t2.micros ||
+                                     t1.utc_offset != t2.utc_offset)) {
+                    diffs.emplace_back(Diff(DiffType::Modified,
+                                            path_string(path1),
+                                            &view2.data()[start], end - start));
+                }
+                break;
+            }
+            case ObjectType::TypedArray: {
+                ObjectType element_type1, element_type2;
+                uint32_t size1, size2;
+                read_typed_array(view1, element_type1, size1);
+                read_typed_array(view2, element_type2, size2);
+
+                // The padding depends on the position, so only the values
+                // are compared
+                const bool equal =
+                    element_type1 == element_type2 && size1 == size2 &&
+                    memcmp(view1.current(), view2.current(),
+                           size1 * TYPED_ARRAY_ELEMENT_SIZE) == 0;
+
+                view1.move_by(size1 * TYPED_ARRAY_ELEMENT_SIZE);
+                view2.move_by(size2 * TYPED_ARRAY_ELEMENT_SIZE);
+
+                uint32_t end = view2.pos();
+
+                if (!inside_diff && !equal) {
+                    diffs.emplace_back(Diff(DiffType::Modified,
+                                            path_string(path1),
+                                            &view2.data()[start], end - start));
+                }
+                break;
+            }
             case ObjectType::Map:
-                parse_map(diffs, inside_diff);
+            case ObjectType::SortedMap:
+                parse_map(type1, diffs, inside_diff);
                 break;
             case ObjectType::Array:
                 parse_array(diffs, inside_diff);
@@ -103,7 +146,7 @@ class DocumentDiffs : public DocumentTraversal {
     std::vector<std::string> path1;
     std::vector<std::string> path2;
 
-    void parse_map(Diffs &diffs, bool inside_diff) {
+    void parse_map(ObjectType type, Diffs &diffs, bool inside_diff) {
         uint32_t byte_size1 = 0, byte_size2 = 0;
         view1 >> byte_size1;
         view2 >> byte_size2;
@@ -112,6 +155,9 @@ class DocumentDiffs : public DocumentTraversal {
         view1 >> size1;
         view2 >> size2;
 
+        skip_key_table(type, size1, view1);
+        skip_key_table(type, size2, view2);
+
         uint32_t i = 0, j = 0;
 
         while (i < size1 || j < size2) {
@@ -330,8 +376,18 @@ class DocumentAdd : public DocumentTraversal {
                 throw json_error("Invalid path");
                 break;
             case ObjectType::Map:
-                parse_map();
+            case ObjectType::SortedMap:
+            case ObjectType::DictionaryMap:
+                // Values are changed in place, so the key table stays valid
+                parse_map(type);
+                break;
+            case ObjectType::KeyDictionary: {
+                const auto outer = m_keys;
+                m_keys.load(m_view);
+                parse_next();
+                m_keys = outer;
                 break;
+            }
             case ObjectType::Array:
                 parse_array();
                 break;
@@ -350,19 +406,19 @@ class DocumentAdd : public DocumentTraversal {
     const std::string m_target_path;
     std::vector<std::string> m_current_path;
     const json::Document &m_value;
+    KeyDictionary m_keys;
 
-    void parse_map() {
+    void parse_map(ObjectType type) {
         uint32_t byte_size = 0;
         m_view >> byte_size;
 
         uint32_t size = 0;
         m_view >> size;
 
-        for (uint32_t i = 0; i < size; ++i) {
-            std::string key;
-            m_view >> key;
+        skip_key_table(type, size, m_view);
 
-            m_current_path.push_back(key);
+        for (uint32_t i = 0; i < size; ++i) {
+            m_current_path.emplace_back(m_keys.read_key(type, m_view));
             parse_next();
             m_current_path.pop_back();
         }
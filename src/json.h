@@ -75,7 +75,9 @@ path_strings(const std::vector<std::string> &path, const json::Document &doc,
         uint32_t size = array_view.get_size();
 
         for (uint32_t i = 0; i < size; ++i) {
-            std::string spath = current_path + "." + std::to_string(i);
+            std::string spath = (current_path == "")
+                                    ? std::to_string(i)
+                                    : current_path + "." + std::to_string(i);
             auto ps = path_strings(path, doc, spath, it);
 
             for (auto &p : ps) {
@@ -91,6 +93,20 @@ path_strings(const std::vector<std::string> &path, const json::Document &doc,
     }
 }
 
+/**
+ * Make room for at least size more bytes after the current position
+ *
+ * The contents and position of the stream do not change.
+ */
+inline void reserve(bitstream &out, uint32_t size) {
+    const uint32_t pos = out.pos();
+
+    out.move_to(out.size());
+    out.make_space(size);
+    out.remove_space(size);
+    out.move_to(pos);
+}
+
 inline std::string path_string(const std::vector<std::string> &path) {
     std::string result = "";
 
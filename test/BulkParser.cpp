@@ -0,0 +1,220 @@
+#include <json/json.h>
+
+#include <gtest/gtest.h>
+
+using namespace json;
+
+class BulkParserTest : public testing::Test {};
+
+namespace {
+
+/// Large enough to be split across several threads
+std::string make_ndjson(size_t count) {
+    std::string out;
+
+    for (size_t i = 0; i < count; ++i) {
+        out += "{\"id\": " + std::to_string(i) +
+               ", \"name\": \"record " + std::to_string(i) +
+               "\", \"tags\": [\"a\", \"b\"], \"score\": 0.5}\n";
+    }
+
+    return out;
+}
+
+} // namespace
+
+TEST(BulkParserTest, documents) {
+    const auto input = make_ndjson(20000);
+
+    for (size_t threads : {1, 2, 3, 8}) {
+        BulkParser parser(threads);
+        auto docs = parser.parse(input);
+
+        ASSERT_EQ(docs.size(), 20000U);
+
+        for (size_t i = 0; i < docs.size(); i += 997) {
+            Document id(docs[i], "id");
+            EXPECT_EQ(id.as_integer(), static_cast<integer_t>(i));
+        }
+    }
+}
+
+TEST(BulkParserTest, length_prefixed) {
+    const auto input = make_ndjson(20000);
+    const auto expected = BulkParser(1).parse(input);
+
+    for (size_t threads : {1, 4}) {
+        bitstream output;
+        BulkParser(threads).parse(input, output);
+
+        output.move_to(0);
+
+        for (auto &doc : expected) {
+            Document record(output);
+            EXPECT_EQ(record, doc);
+        }
+
+        EXPECT_TRUE(output.at_end());
+    }
+}
+
+TEST(BulkParserTest, blank_lines) {
+    const std::string input = "\n{\"a\":1}\r\n   \n[2]\n\t\n3";
+
+    auto docs = BulkParser(2).parse(input);
+
+    ASSERT_EQ(docs.size(), 3U);
+    EXPECT_EQ(docs[0], Document("{\"a\":1}"));
+    EXPECT_EQ(docs[1], Document("[2]"));
+    EXPECT_EQ(docs[2].as_integer(), 3);
+}
+
+TEST(BulkParserTest, invalid_record) {
+    auto input = make_ndjson(20000);
+    input += "{\"broken\": }\n";
+    input += make_ndjson(10);
+
+    BulkParser parser(4);
+    EXPECT_THROW(parser.parse(input), json_error);
+
+    bitstream output;
+    EXPECT_THROW(parser.parse(input, output), json_error);
+}
+
+TEST(BulkParserTest, extra_values) {
+    const Document predicates("{\"id\": 1}");
+
+    for (const std::string input :
+         {"{\"id\": 1}\n{\"id\": 1} {\"id\": 1}\n",
+          "{\"id\": 1}\n{\"id\": 1} trailing\n"}) {
+        BulkParser parser(2);
+        EXPECT_THROW(parser.parse(input), json_error);
+        EXPECT_THROW(parser.parse(input, predicates), json_error);
+
+        bitstream output;
+        EXPECT_THROW(parser.parse(input, output), json_error);
+        EXPECT_THROW(parser.parse(input, predicates, output), json_error);
+    }
+}
+
+TEST(BulkParserTest, predicates_duplicate_keys) {
+    const std::string input = "{\"a\":[1,2],\"a\":3}\n"
+                              "{\"a\":3,\"a\":[1,2]}\n"
+                              "{\"a\":[2],\"a\":[3]}\n";
+
+    const auto all = BulkParser(1).parse(input);
+
+    for (std::string predicate : {"{\"a.*\": 2}", "{\"a\": 3}"}) {
+        const Document predicates(predicate);
+        const auto docs = BulkParser(1).parse(input, predicates);
+
+        size_t expected = 0;
+
+        for (auto &doc : all) {
+            expected += doc.matches_predicates(predicates) ? 1 : 0;
+        }
+
+        EXPECT_EQ(docs.size(), expected) << predicate;
+    }
+}
+
+TEST(BulkParserTest, huge_array) {
+    std::string input = "[";
+
+    for (size_t i = 0; i < 20000; ++i) {
+        input += i > 0 ? ", " : "";
+        input += i % 2 == 0 ? "{\"id\": " + std::to_string(i) +
+                                  ", \"list\": [1, [2, {}], \"x,]\"]}"
+                            : std::to_string(i);
+    }
+
+    input += "]";
+
+    const auto expected = Document::parse(input);
+
+    for (size_t threads : {1, 2, 3, 8}) {
+        auto doc = BulkParser(threads).parse_array(input);
+
+        EXPECT_EQ(doc.get_size(), 20000U);
+        EXPECT_EQ(doc, expected);
+    }
+}
+
+TEST(BulkParserTest, huge_array_invalid) {
+    std::string input = "[";
+
+    for (size_t i = 0; i < 20000; ++i) {
+        input += "[1, 2, 3], ";
+    }
+
+    for (std::string end : {"]", "4 5]", "{\"a\" 1}]", "[1]"}) {
+        EXPECT_THROW(BulkParser(4).parse_array(input + end), json_error)
+            << end;
+    }
+}
+
+TEST(BulkParserTest, huge_array_fallback) {
+    const auto input = make_ndjson(20000);
+    const std::string map = "{\"a\": [1, 2, 3]}";
+
+    EXPECT_EQ(BulkParser(4).parse_array(map), Document(map));
+    EXPECT_EQ(BulkParser(4).parse_array("[]"), Document("[]"));
+    EXPECT_EQ(BulkParser(4).parse_array("  " + input).get_type(),
+              ObjectType::Map);
+}
+
+TEST(BulkParserTest, predicates) {
+    std::string input;
+
+    for (size_t i = 0; i < 5000; ++i) {
+        const auto n = std::to_string(i);
+
+        input += "{\"id\": " + n + ", \"name\": \"record " + n +
+                 "\", \"score\": " + std::to_string(i * 0.5) +
+                 ", \"tags\": [\"t" + std::to_string(i % 3) + "\", " +
+                 std::to_string(i % 5) + ", {\"k\": " + std::to_string(i % 7) +
+                 "}], \"nested\": {\"x\": " + std::to_string(i % 4) +
+                 ", \"list\": [1, [2, {}], \"x,]\"]}}\n";
+    }
+
+    const auto all = BulkParser(1).parse(input);
+
+    for (std::string predicate :
+         {"{}", "{\"id\": {\"$lt\": 100}}", "{\"nested.x\": 2}",
+          "{\"nested\": {\"x\": {\"$in\": [1, 3]}}}", "{\"tags.1\": 4}",
+          "{\"tags.2.k\": 3}", "{\"tags.*.k\": 5}", "{\"tags.*\": \"t1\"}",
+          "{\"name\": \"record 7\"}", "{\"score\": {\"$gte\": 2000.0}}",
+          "{\"id\": {\"$neq\": 3}, \"nested.x\": 0}", "{\"missing\": 1}"}) {
+        const Document predicates(predicate);
+
+        std::vector<Document> expected;
+
+        for (auto &doc : all) {
+            if (doc.matches_predicates(predicates)) {
+                expected.push_back(doc.duplicate());
+            }
+        }
+
+        for (size_t threads : {1, 4}) {
+            auto docs = BulkParser(threads).parse(input, predicates);
+
+            ASSERT_EQ(docs.size(), expected.size()) << predicate;
+
+            for (size_t i = 0; i < docs.size(); ++i) {
+                EXPECT_EQ(docs[i], expected[i]) << predicate;
+            }
+
+            bitstream output;
+            BulkParser(threads).parse(input, predicates, output);
+
+            output.move_to(0);
+
+            for (auto &doc : expected) {
+                Document record(output);
+                EXPECT_EQ(record, doc) << predicate;
+            }
+
+            EXPECT_TRUE(output.at_end()) << predicate;
+        }
+    }
+}
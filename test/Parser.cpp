@@ -0,0 +1,814 @@
+#include <json/json.h>
+
+#include "IndexedParser.h"
+#include "NumberParser.h"
+#include "Parser.h"
+#include "StructuralIndex.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+using namespace json;
+
+namespace {
+
+std::atomic<size_t> allocation_count(0);
+
+void *allocate(std::size_t size) {
+    ++allocation_count;
+    return std::malloc(size > 0 ? size : 1);
+}
+
+void *allocate(std::size_t size, std::align_val_t alignment) {
+    ++allocation_count;
+
+    // The size has to be a non-zero multiple of the alignment
+    const auto align = static_cast<std::size_t>(alignment);
+    const std::size_t rounded = (size + align - 1) / align * align;
+    return std::aligned_alloc(align, rounded > 0 ? rounded : align);
+}
+
+} // namespace
+
+// Count all heap allocations so that tests can check for regressions. Every
+// form is replaced, so that none of them bypasses the count and memory is
+// always released by the allocator that provided it.
+void *operator new(std::size_t size) {
+    if (void *ptr = allocate(size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    if (void *ptr = allocate(size, alignment)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+    return allocate(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+    return allocate(size, alignment);
+}
+
+// GCC does not know that the forms of operator new above use malloc
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+class ParserTest : public testing::Test {};
+
+namespace {
+
+bitstream parse_reference(const std::string &str) {
+    bitstream result;
+    Parser parser(str, result);
+    parser.do_parse();
+    return result;
+}
+
+bitstream parse_indexed(const std::string &str,
+                        IndexKernel kernel = IndexKernel::Best) {
+    bitstream result;
+    IndexedParser parser(str, result, kernel);
+    parser.do_parse();
+    return result;
+}
+
+/**
+ * Number of heap allocations made while parsing the input a second time
+ *
+ * The output buffer is reused so that it does not need to grow.
+ */
+template <typename ParserType>
+size_t count_allocations(const std::string &str) {
+    bitstream result;
+
+    {
+        ParserType parser(str, result);
+        parser.do_parse();
+    }
+
+    result.move_to(0);
+    const size_t before = allocation_count;
+
+    ParserType parser(str, result);
+    parser.do_parse();
+
+    return allocation_count - before;
+}
+
+std::string make_records(size_t count) {
+    std::string out = "[";
+
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            out += ",";
+        }
+
+        out += "{\"a rather long key name\": [1, 2.5, true, false, null],"
+               "\"string\": \"a value that does not fit into SSO\","
+               "\"esc\\\"aped key\": {\"x\": \"esc\\naped value\"},"
+               "\"when\": d\"2020-01-01 10:00:00\"}";
+    }
+
+    return out + "]";
+}
+
+std::vector<IndexKernel> supported_kernels() {
+    std::vector<IndexKernel> result;
+
+    for (auto kernel :
+         {IndexKernel::Scalar, IndexKernel::SSE42, IndexKernel::AVX2}) {
+        if (StructuralIndex::kernel_supported(kernel)) {
+            result.push_back(kernel);
+        }
+    }
+
+    return result;
+}
+
+/// Deterministic pseudo-random JSON text
+class DocumentGenerator {
+  public:
+    explicit DocumentGenerator(uint64_t seed) : m_state(seed) {}
+
+    std::string generate(int depth) {
+        std::string out;
+        write_value(out, depth);
+        return out;
+    }
+
+  private:
+    uint32_t next(uint32_t max) {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(m_state >> 33) % max;
+    }
+
+    void write_space(std::string &out) {
+        static const char *spaces[] = {"", " ", "\n", "\t ", "\r\n  "};
+        out += spaces[next(5)];
+    }
+
+    void write_string(std::string &out) {
+        static const char chars[] = "abc xyz{}[],:0123456789-";
+        static const char *escapes[] = {"\\\"", "\\\\", "\\n",
+                                        "\\u00e9", "\\ud83d\\ude00"};
+        out += '"';
+
+        auto len = next(90);
+        for (uint32_t i = 0; i < len; ++i) {
+            if (next(16) == 0) {
+                out += escapes[next(5)];
+            } else {
+                out += chars[next(sizeof(chars) - 1)];
+            }
+        }
+
+        out += '"';
+    }
+
+    void write_value(std::string &out, int depth) {
+        write_space(out);
+
+        switch (next(depth > 0 ? 9 : 7)) {
+        case 0:
+            write_string(out);
+            break;
+        case 1:
+            out += std::to_string(static_cast<int64_t>(next(1 << 30)) - 5000);
+            break;
+        case 2:
+            out += std::to_string(next(1000)) + "." +
+                   std::to_string(next(100)) + "e-" + std::to_string(next(9));
+            break;
+        case 3:
+            out += "true";
+            break;
+        case 4:
+            out += "false";
+            break;
+        case 5:
+            out += "null";
+            break;
+        case 6:
+            out += "d\"2019-04-0" + std::to_string(1 + next(9)) + " 10:3" +
+                   std::to_string(next(10)) + ":00\"";
+            break;
+        case 7: {
+            out += '{';
+            auto size = next(6);
+            for (uint32_t i = 0; i < size; ++i) {
+                if (i > 0) {
+                    out += ',';
+                }
+                write_space(out);
+                out += "\"key" + std::to_string(i) + "\"";
+                write_space(out);
+                out += ':';
+                write_value(out, depth - 1);
+                write_space(out);
+            }
+            out += '}';
+            break;
+        }
+        default: {
+            out += '[';
+            auto size = next(6);
+            for (uint32_t i = 0; i < size; ++i) {
+                if (i > 0) {
+                    out += ',';
+                }
+                write_value(out, depth - 1);
+                write_space(out);
+            }
+            out += ']';
+            break;
+        }
+        }
+
+        write_space(out);
+    }
+
+    uint64_t m_state;
+};
+
+} // namespace
+
+TEST(ParserTest, indexed_matches_reference) {
+    const std::vector<std::string> inputs = {
+        "{}",
+        "[]",
+        "42",
+        "-7",
+        "1.25e3",
+        "true",
+        "null",
+        "\"foo bar\"",
+        "{\"a\" :1}",
+        "{ \"a\" : [ 1 , 2 , { \"b\" : null } ] , \"c\" : \"x\" }",
+        "[\"{\", \"}\", \"[\", \"]\", \":\", \",\"]",
+        "\r\n{\"a\":\r\n\t[false,true]}\r\n",
+        "{\"when\":d\"1955-11-05 12:00:00\",\"x\":[]}",
+        "[[[[[]]]],{},{\"a\":{}}]"};
+
+    for (auto &input : inputs) {
+        EXPECT_TRUE(parse_reference(input) == parse_indexed(input)) << input;
+    }
+}
+
+TEST(ParserTest, indexed_matches_reference_generated) {
+    for (uint64_t seed = 1; seed <= 200; ++seed) {
+        DocumentGenerator generator(seed);
+        auto input = generator.generate(5);
+
+        auto expected = parse_reference(input);
+
+        for (auto kernel : supported_kernels()) {
+            EXPECT_TRUE(expected == parse_indexed(input, kernel)) << input;
+        }
+    }
+}
+
+TEST(ParserTest, indexed_rejects_invalid) {
+    const std::vector<std::string> inputs = {
+        "{\"a\":1,}", "[1 2]", "{\"a\" 1}", "[1,2",  "{\"a\":1",
+        "[12ab]",     "\"abc", "{1:2}",     "[,1]", "[}"};
+
+    for (auto &input : inputs) {
+        EXPECT_THROW(parse_indexed(input), json_error) << input;
+    }
+}
+
+TEST(ParserTest, kernels_agree) {
+    // Backslash runs and quotes at every offset around a block boundary
+    std::vector<std::string> inputs;
+
+    for (size_t offset = 50; offset < 70; ++offset) {
+        for (size_t slashes = 1; slashes < 5; ++slashes) {
+            std::string input = "[\"";
+            input += std::string(offset, 'x');
+            input += std::string(slashes, '\\');
+            if (slashes % 2 == 1) {
+                input += '"';
+            }
+            input += "\" , 1, \"\\\"{\" ,{\"k\":[true]} ]";
+            inputs.push_back(input);
+        }
+    }
+
+    for (auto &input : inputs) {
+        StructuralIndex expected;
+        expected.build(input.data(), input.size(), IndexKernel::Scalar);
+
+        for (auto kernel : supported_kernels()) {
+            StructuralIndex index;
+            index.build(input.data(), input.size(), kernel);
+            EXPECT_EQ(expected.positions(), index.positions()) << input;
+        }
+    }
+}
+
+TEST(ParserTest, windowed_index) {
+    std::vector<std::string> inputs;
+
+    // A sequence, an escape and the end of a string at every offset around
+    // the end of the first window
+    for (size_t shift = 0; shift < 5; ++shift) {
+        inputs.push_back("[\"" +
+                         std::string(INDEX_WINDOW_SIZE - 2 - shift, 'x') +
+                         "\xE2\x82\xAC\\\"\", 1, " +
+                         std::string(INDEX_WINDOW_SIZE, ' ') + "2]");
+    }
+
+    std::string records = "[";
+
+    while (records.size() < 5 * INDEX_WINDOW_SIZE) {
+        records += "\"caf\xC3\xA9\", 12, {\"k\": [true, null]}, \"";
+        records += std::string(records.size() % 1000, 'y') + "\", ";
+    }
+
+    inputs.push_back(records + "0]");
+
+    for (auto &input : inputs) {
+        const size_t windows =
+            (input.size() + INDEX_WINDOW_SIZE - 1) / INDEX_WINDOW_SIZE;
+
+        for (auto kernel : supported_kernels()) {
+            StructuralIndex expected;
+            expected.build(input.data(), input.size(), kernel, true);
+
+            StructuralIndex index;
+            index.start(input.data(), input.size(), kernel, true);
+            EXPECT_EQ(index.size(), 0U);
+
+            size_t count = 0;
+
+            while (index.index_more()) {
+                ++count;
+            }
+
+            EXPECT_TRUE(index.complete());
+            EXPECT_EQ(count, windows);
+            EXPECT_EQ(index.positions(), expected.positions());
+            EXPECT_TRUE(parse_indexed(input, kernel) ==
+                        parse_reference(input));
+        }
+    }
+}
+
+TEST(ParserTest, utf8_validation) {
+    const std::vector<std::string> valid = {
+        "a", "\xC2\xA2", "\xE2\x82\xAC", "\xED\x9F\xBF", "\xEF\xBF\xBF",
+        "\xF0\x90\x8D\x88", "\xF4\x8F\xBF\xBF"};
+
+    // Truncated, overlong, surrogates, too large and stray continuations
+    const std::vector<std::string> invalid = {
+        "\xC2",         "\xE2\x82",         "\xF0\x90\x8D", "\xC0\xAF",
+        "\xE0\x80\xAF", "\xF0\x80\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80",
+        "\xF8\x88\x80", "\x80",             "\xBF\xBF",     "\xC2" "A",
+        "\xFF"};
+
+    // Sequences at every offset around block boundaries, and at the very end
+    for (size_t offset = 56; offset < 72; ++offset) {
+        for (size_t tail : {size_t(0), size_t(2), size_t(100)}) {
+            for (auto &sequence : valid) {
+                auto input = "[\"" + std::string(offset, 'x') + sequence +
+                             std::string(tail, 'y') + "\"]";
+
+                for (auto kernel : supported_kernels()) {
+                    StructuralIndex index;
+                    EXPECT_NO_THROW(index.build(input.data(), input.size(),
+                                                kernel, true))
+                        << input;
+                }
+            }
+
+            for (auto &sequence : invalid) {
+                auto input = "[\"" + std::string(offset, 'x') + sequence +
+                             std::string(tail, 'y');
+
+                for (auto kernel : supported_kernels()) {
+                    StructuralIndex index;
+
+                    try {
+                        index.build(input.data(), input.size(), kernel, true);
+                        ADD_FAILURE() << "Accepted " << input;
+                    } catch (const json_parse_error &e) {
+                        EXPECT_EQ(e.code(), ParseErrorCode::InvalidUtf8);
+                        EXPECT_EQ(e.offset(), offset + 2) << input;
+                    }
+
+                    // Validation is off by default
+                    input += "\"]";
+                    EXPECT_NO_THROW(
+                        index.build(input.data(), input.size(), kernel));
+                    input.resize(input.size() - 2);
+                }
+            }
+        }
+    }
+}
+
+TEST(ParserTest, utf8_kernels_agree) {
+    // Mostly valid text with some bytes replaced at random
+    const std::string text = "ab\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80 c";
+    uint64_t state = 42;
+
+    for (size_t round = 0; round < 2000; ++round) {
+        std::string input;
+
+        while (input.size() < 300) {
+            input += text;
+        }
+
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        const size_t count = (state >> 33) % 3;
+
+        for (size_t i = 0; i < count; ++i) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            input[(state >> 33) % input.size()] =
+                static_cast<char>(state >> 56);
+        }
+
+        size_t expected = input.size();
+
+        try {
+            StructuralIndex index;
+            index.build(input.data(), input.size(), IndexKernel::Scalar,
+                        true);
+        } catch (const json_parse_error &e) {
+            expected = e.offset();
+        }
+
+        for (auto kernel : supported_kernels()) {
+            size_t offset = input.size();
+
+            try {
+                StructuralIndex index;
+                index.build(input.data(), input.size(), kernel, true);
+            } catch (const json_parse_error &e) {
+                offset = e.offset();
+            }
+
+            EXPECT_EQ(expected, offset);
+        }
+    }
+}
+
+TEST(ParserTest, structural_positions) {
+    std::string input = "{\"a\" : [1, \"x,y\" ,true]}";
+
+    StructuralIndex index;
+    index.build(input.data(), input.size());
+
+    std::vector<uint32_t> expected = {0, 1, 5, 7, 8, 9, 11, 17, 18, 22, 23};
+    EXPECT_EQ(index.positions(), expected);
+}
+
+TEST(ParserTest, integers) {
+    EXPECT_EQ(Document("0").as_integer(), 0);
+    EXPECT_EQ(Document("-0").as_integer(), 0);
+    EXPECT_EQ(Document("1337").as_integer(), 1337);
+    EXPECT_EQ(Document("9223372036854775807").as_integer(),
+              std::numeric_limits<integer_t>::max());
+    EXPECT_EQ(Document("-9223372036854775808").as_integer(),
+              std::numeric_limits<integer_t>::min());
+}
+
+TEST(ParserTest, integer_overflow) {
+    EXPECT_THROW(Document("9223372036854775808"), json_error);
+    EXPECT_THROW(Document("-9223372036854775809"), json_error);
+    EXPECT_THROW(Document("[123456789012345678901234567890]"), json_error);
+}
+
+TEST(ParserTest, floats) {
+    const std::vector<std::string> inputs = {
+        "0.1",
+        "-2.5e-3",
+        "1E+2",
+        "0.30000000000000004",
+        "9007199254740993.0",
+        "2.2250738585072011e-308",
+        "4.9e-324",
+        "1.7976931348623157e308",
+        "3.14159265358979323846264338327950288",
+        "1.00000000000000011102230246251565404236316680908203125",
+        "123456789012345678901234567890.0"};
+
+    for (auto &input : inputs) {
+        NumberParser number;
+        auto end = number.parse(input.data(), input.data() + input.size());
+
+        double expected = 0.0;
+        std::from_chars(input.data(), input.data() + input.size(), expected);
+
+        EXPECT_EQ(end, input.data() + input.size());
+        EXPECT_FALSE(number.is_integer());
+        EXPECT_EQ(number.floating(), expected) << input;
+    }
+}
+
+TEST(ParserTest, invalid_numbers) {
+    const std::vector<std::string> inputs = {"-", "1.", ".5",  "+1",
+                                             "1e", "1e+", "-a", "[01]"};
+
+    for (auto &input : inputs) {
+        EXPECT_THROW(Document doc(input), json_error) << input;
+    }
+}
+
+TEST(ParserTest, string_escapes) {
+    Document doc("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"");
+    EXPECT_EQ(doc.as_string(), "a\"b\\c/d\b\f\n\r\t");
+}
+
+TEST(ParserTest, unicode_escapes) {
+    EXPECT_EQ(Document("\"\\u0041\"").as_string(), "A");
+    EXPECT_EQ(Document("\"\\u00e9\"").as_string(), "\xc3\xa9");
+    EXPECT_EQ(Document("\"\\u20AC\"").as_string(), "\xe2\x82\xac");
+    EXPECT_EQ(Document("\"\\ud83d\\ude00\"").as_string(), "\xf0\x9f\x98\x80");
+    EXPECT_EQ(Document("\"\\u0000\"").as_string(), std::string(1, '\0'));
+}
+
+TEST(ParserTest, invalid_escapes) {
+    const std::vector<std::string> inputs = {
+        "\"\\x\"",         "\"\\u12\"",          "\"\\u12g4\"",
+        "\"\\ud83d\"",     "\"\\ud83d\\n\"",     "\"\\ud83d\\u0041\"",
+        "\"\\ude00\"",     "\"abc\\",            "{\"\\q\":1}"};
+
+    for (auto &input : inputs) {
+        EXPECT_THROW(parse_reference(input), json_error) << input;
+        EXPECT_THROW(parse_indexed(input), json_error) << input;
+    }
+}
+
+TEST(ParserTest, escapes_at_every_offset) {
+    // Make sure the vectorized scan does not miss quotes or backslashes
+    for (size_t len = 0; len < 40; ++len) {
+        for (size_t pos = 0; pos <= len; ++pos) {
+            std::string expected(len, 'x');
+            expected.insert(pos, "\"");
+
+            std::string input = "[\"" + std::string(pos, 'x') + "\\\"" +
+                                std::string(len - pos, 'x') + "\"]";
+
+            Document doc(input);
+            EXPECT_EQ(doc.get_child(0).as_string(), expected) << input;
+        }
+    }
+}
+
+TEST(ParserTest, escaped_round_trip) {
+    Document doc("{\"k\\\"ey\":[\"line\\nbreak\", \"\\u0001\\\\\"]}");
+    Document copy(doc.str());
+
+    EXPECT_EQ(doc.str(), "{\"k\\\"ey\":[\"line\\nbreak\",\"\\u0001\\\\\"]}");
+    EXPECT_EQ(doc, copy);
+}
+
+TEST(ParserTest, no_allocations_per_value) {
+    const auto small = make_records(10);
+    const auto large = make_records(1000);
+
+    EXPECT_EQ(count_allocations<Parser>(small),
+              count_allocations<Parser>(large));
+
+    // Only the structural index grows with the input
+    EXPECT_LT(count_allocations<IndexedParser>(large), 20U);
+}
+
+TEST(ParserTest, recycled_buffers) {
+    const auto first = make_records(100);
+    const auto second = make_records(99) + " ";
+
+    DocumentParser parser;
+    Document doc;
+
+    parser.parse(first, doc);
+    EXPECT_EQ(doc, Document::parse(first));
+
+    const auto *buffer = doc.data().data();
+    const size_t before = allocation_count;
+
+    for (size_t i = 0; i < 10; ++i) {
+        parser.parse(i % 2 == 0 ? first : second, doc);
+    }
+
+    EXPECT_EQ(allocation_count - before, 0U);
+    EXPECT_EQ(doc.data().data(), buffer);
+    EXPECT_EQ(doc, Document::parse(second));
+
+    bitstream output;
+    parser.parse("[1, 2]", output);
+    parser.parse("{\"a\": null}", output);
+
+    output.move_to(0);
+    EXPECT_EQ(Document::parse("[1, 2]").data().size() +
+                  Document::parse("{\"a\": null}").data().size(),
+              output.size());
+
+    EXPECT_THROW(parser.parse("{\"a\": }", doc), json_error);
+
+    parser.parse("", doc);
+    EXPECT_TRUE(doc.empty());
+}
+
+TEST(ParserTest, try_parse) {
+    Document doc;
+
+    auto error = Document::try_parse("{\"a\": [1, 2.5, \"x\"]}", doc);
+
+    EXPECT_FALSE(error);
+    EXPECT_EQ(doc, Document("{\"a\": [1, 2.5, \"x\"]}"));
+
+    const std::string input = "{\"a\": 1,\n \"bc\": [tru, 2]}";
+    error = Document::try_parse(input, doc);
+
+    EXPECT_EQ(error.code, ParseErrorCode::InvalidLiteral);
+    EXPECT_EQ(error.offset, input.find("tru") + 3);
+    EXPECT_EQ(error.line, 2U);
+    EXPECT_EQ(error.column, 12U);
+    EXPECT_EQ(error.snippet, input.substr(4));
+    EXPECT_STREQ(error_message(error.code), "Invalid literal");
+
+    const std::vector<std::pair<std::string, ParseErrorCode>> cases = {
+        {"{\"a\": [1, 2", ParseErrorCode::UnexpectedEnd},
+        {"[\"abc", ParseErrorCode::UnexpectedEnd},
+        {"[\"\\q\"]", ParseErrorCode::InvalidEscape},
+        {"[1, 2e]", ParseErrorCode::InvalidNumber},
+        {"[99999999999999999999]", ParseErrorCode::NumberOutOfRange},
+        {"{\"a\" 1}", ParseErrorCode::InvalidMap},
+        {"[1 2]", ParseErrorCode::InvalidArray},
+        {"[1, ?]", ParseErrorCode::InvalidValue},
+        {"d\"2020\"", ParseErrorCode::InvalidDatetime},
+        {"[1]]", ParseErrorCode::TrailingInput},
+        {"{}}", ParseErrorCode::TrailingInput},
+        {"1 2", ParseErrorCode::TrailingInput}};
+
+    for (auto &[text, code] : cases) {
+        error = Document::try_parse(text, doc);
+
+        EXPECT_EQ(error.code, code) << text;
+        EXPECT_LE(error.offset, text.size()) << text;
+    }
+
+    // Anything after the value is reported where it starts
+    EXPECT_EQ(Document::try_parse("[1] ,2", doc).offset, 4U);
+}
+
+TEST(ParserTest, try_parse_utf8) {
+    const std::string input =
+        "{\"name\": \"caf\xC3\xA9\", \"bad\": \"\xE9t\xE9\"}";
+
+    Document doc;
+    EXPECT_FALSE(Document::try_parse(input, doc));
+
+    ParseOptions options;
+    options.validate_utf8 = true;
+
+    auto error = Document::try_parse(input, doc, options);
+
+    EXPECT_EQ(error.code, ParseErrorCode::InvalidUtf8);
+    EXPECT_EQ(error.offset, input.find('\xE9'));
+    EXPECT_STREQ(error_message(error.code), "Invalid UTF-8");
+
+    DocumentParser parser(options);
+    EXPECT_TRUE(parser.try_parse(input, doc));
+    EXPECT_FALSE(parser.try_parse("[\"caf\xC3\xA9\"]", doc));
+    EXPECT_EQ(doc, Document::parse("[\"caf\xC3\xA9\"]"));
+}
+
+TEST(ParserTest, bounded_errors) {
+    std::string input = "[1, x";
+
+    while (input.size() < 1000000) {
+        input += ", 1";
+    }
+
+    input += "]";
+
+    DocumentParser parser;
+    Document doc;
+
+    auto error = parser.try_parse(input, doc);
+
+    EXPECT_EQ(error.code, ParseErrorCode::InvalidValue);
+    EXPECT_EQ(error.offset, 4U);
+    EXPECT_EQ(error.snippet, input.substr(0, 20));
+    EXPECT_TRUE(doc.empty());
+
+    // Input after the error is not even indexed, so neither the string that
+    // never ends nor the invalid UTF-8 behind it are found
+    input += "\"\xFF";
+
+    ParseOptions options;
+    options.validate_utf8 = true;
+
+    DocumentParser validating(options);
+
+    for (auto *p : {&parser, &validating}) {
+        error = p->try_parse(input, doc);
+
+        EXPECT_EQ(error.code, ParseErrorCode::InvalidValue);
+        EXPECT_EQ(error.offset, 4U);
+    }
+
+    // Nothing of a partially parsed document is kept
+    EXPECT_TRUE(parser.try_parse("{\"a\": [1,2,{\"b\": tru}]}", doc));
+    EXPECT_TRUE(doc.empty());
+
+    // The parser can be used again after an error
+    EXPECT_FALSE(parser.try_parse("[1]", doc));
+    EXPECT_EQ(doc, Document("[1]"));
+
+    // Messages of exceptions do not contain the whole input either
+    std::string map = "{\"a\" 1";
+
+    while (map.size() < 1000000) {
+        map += " ";
+    }
+
+    map += "}";
+
+    try {
+        bitstream result;
+        Parser(map, result).do_parse();
+        FAIL();
+    } catch (const json_parse_error &e) {
+        EXPECT_EQ(e.code(), ParseErrorCode::InvalidMap);
+        EXPECT_LT(strlen(e.what()), 200U);
+    }
+}
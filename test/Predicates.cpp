@@ -121,3 +121,17 @@ TEST(PredicatesTest, wildcard_predicate) {
     EXPECT_TRUE(doc1.matches_predicates(predicate2));
     EXPECT_TRUE(doc2.matches_predicates(predicate3));
 }
+
+TEST(PredicatesTest, datetime_predicate) {
+    Document doc("{\"when\": d\"2020-01-01 10:00:00+02:00\"}");
+
+    Document predicate1("{\"when\": d\"2020-01-01T08:00:00Z\"}");
+    Document predicate2("{\"when\": {\"$lt\": d\"2020-01-01 09:00:00\"}}");
+    Document predicate3("{\"when\": {\"$gte\": d\"2020-01-01 08:00:01\"}}");
+    Document predicate4("{\"when\": {\"$in\": [d\"2020-01-01 08:00:00\"]}}");
+
+    EXPECT_TRUE(doc.matches_predicates(predicate1));
+    EXPECT_TRUE(doc.matches_predicates(predicate2));
+    EXPECT_FALSE(doc.matches_predicates(predicate3));
+    EXPECT_TRUE(doc.matches_predicates(predicate4));
+}
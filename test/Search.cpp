@@ -50,3 +50,399 @@ TEST(Search, wildcard_filter_nested) {
 
     EXPECT_EQ(filtered.str(), "{\"a\":[{\"b\":{\"c\":42}}]}");
 }
+
+TEST(Search, parse_projected) {
+    const std::string text =
+        "{\"a\":[{\"b\":41,\"c\":{\"d\":[1,2]}},{\"b\":43}],"
+        "\"e\":\"skip \\\"me\\\" [{\",\"f\":{\"g\":true,\"h\":null},"
+        "\"i\":[[0],[1,{\"j\":2}],[2]]}";
+    const Document doc(text);
+
+    const std::vector<std::vector<std::string>> projections = {
+        {"f"},         {"f.g"},         {"a.*.b"},   {"a.0.c.d.1"},
+        {"a.1", "e"},  {"i.1.1.j"},     {"i.*.0"},   {"x"},
+        {"f.g.x"},     {"f", "f.h"},    {""}};
+
+    for (auto &paths : projections) {
+        auto expected = Document(doc, paths);
+        auto projected = Document::parse(text, paths);
+
+        EXPECT_EQ(projected.str(), expected.str()) << paths[0];
+    }
+}
+
+TEST(Search, parse_projected_wildcards) {
+    const std::vector<std::string> texts = {
+        "[[1,2],[3],{\"a\":4}]", "{\"a\":{\"b\":1,\"*\":2},\"c\":[]}",
+        "{\"a\":[{\"b\":[]},{\"b\":{\"d\":1}},{\"b\":[5]}],\"c\":3}", "7",
+        // Wildcards are expanded at the last entry with the same key
+        "{\"k3\":[1,2],\"k3\":1}", "{\"k3\":[1,2],\"k3\":[3]}",
+        "{\"a\":[1],\"a\":{\"x\":1}}", "{\"a\":{\"b\":[1]},\"a\":{\"c\":2}}"};
+
+    const std::vector<std::vector<std::string>> projections = {
+        {"*"},       {"*.1"},        {"*.a"},      {"a.*"},
+        {"a.*", "c"}, {"c.*"},       {"a.*.b.*"},  {"a.0.b", "a.*.b.*"},
+        {"a.x.*"},   {"a.b.*", "x"}, {"k3.*"},     {"a.x", "a.*"},
+        {}};
+
+    for (auto &text : texts) {
+        const Document doc(text);
+
+        for (auto &paths : projections) {
+            auto expected = Document(doc, paths);
+            auto projected = Document::parse(text, paths);
+
+            EXPECT_EQ(projected.valid(), expected.valid()) << text;
+            EXPECT_EQ(projected.str(), expected.str()) << text;
+        }
+    }
+
+    EXPECT_EQ(Document::parse("", {"a.*"}), Document::parse(""));
+}
+
+TEST(Search, parse_projected_invalid) {
+    EXPECT_THROW(Document::parse("{\"a\":1,\"b\":[1}", {"a"}),
+                 json_parse_error);
+    EXPECT_THROW(Document::parse("{\"a\":1 2}", {"a"}), json_parse_error);
+    EXPECT_THROW(Document::parse("{\"a\":{\"b\":}}", {"a.b"}),
+                 json_parse_error);
+}
+
+TEST(Search, sorted_map) {
+    std::string text = "{\"users\": {";
+
+    for (int i = 0; i < 200; ++i) {
+        // Not in key order, so that sorting actually moves entries
+        const int id = (i * 37) % 200;
+        text += (i > 0 ? ",\"u" : "\"u") + std::to_string(id) +
+                "\": {\"count\": " + std::to_string(id) + "}";
+    }
+
+    text += "}, \"x\": [1, 2]}";
+
+    const Document original(text);
+    Document doc(text);
+    doc.sort_map_keys();
+
+    EXPECT_EQ(Document(doc, "users").get_type(), ObjectType::SortedMap);
+    EXPECT_EQ(doc.get_type(), ObjectType::Map);
+    EXPECT_EQ(doc.str(), original.str());
+    EXPECT_TRUE(doc.valid());
+
+    for (int i = 0; i < 200; ++i) {
+        const auto path = "users.u" + std::to_string(i) + ".count";
+        EXPECT_EQ(Document(doc, path).as_integer(), i) << path;
+    }
+
+    EXPECT_FALSE(Document(doc, "users.u200").valid());
+    EXPECT_FALSE(Document(doc, "users.a").valid());
+    EXPECT_EQ(Document(doc, "x.1").as_integer(), 2);
+
+    // Entries keep their order for positional access and projections
+    const Document users(doc, "users");
+    EXPECT_EQ(users.get_key(1), "u37");
+    EXPECT_EQ(Document(users.get_child(1), "count").as_integer(), 37);
+    EXPECT_EQ(Document(doc, std::vector<std::string>{"users.u5"}).str(),
+              "{\"users\":{\"u5\":{\"count\":5}}}");
+
+    EXPECT_TRUE(doc.matches_predicates(Document("{\"users.u7.count\": 7}")));
+    EXPECT_FALSE(doc.matches_predicates(Document("{\"users.u7.count\": 8}")));
+
+    // Sorted maps cannot be changed in place
+    EXPECT_FALSE(doc.insert("users.u1", Document("1")));
+    EXPECT_FALSE(doc.insert("users.u1.extra", Document("1")));
+    EXPECT_EQ(doc.str(), original.str());
+
+    doc.sort_map_keys(0);
+    EXPECT_EQ(doc, original);
+
+    EXPECT_TRUE(doc.insert("users.u1.extra", Document("1")));
+    EXPECT_EQ(Document(doc, "users.u1.extra").as_integer(), 1);
+}
+
+TEST(Search, sorted_map_duplicate_keys) {
+    const Document original(
+        "{\"b\":1,\"a\":1,\"b\":2,\"c\":0,\"b\":{\"x\":3},\"a\":4}");
+
+    auto sorted = original.duplicate(true);
+    sorted.sort_map_keys(1);
+    EXPECT_EQ(sorted.get_type(), ObjectType::SortedMap);
+
+    // Both find the last of several equal keys
+    for (std::string path : {"a", "b", "b.x", "c"}) {
+        EXPECT_EQ(Document(sorted, path).str(), Document(original, path).str())
+            << path;
+    }
+
+    EXPECT_EQ(Document(sorted, "a").as_integer(), 4);
+}
+
+TEST(Search, key_dictionary) {
+    std::string text = "{\"items\": [";
+
+    for (int i = 0; i < 50; ++i) {
+        text += (i > 0 ? "," : "") + std::string("{\"name\": \"item") +
+                std::to_string(i) + "\", \"count\": " + std::to_string(i) +
+                ", \"tags\": {\"count\": true}}";
+    }
+
+    text += "], \"total\": 50}";
+
+    const Document original(text);
+    Document doc(text);
+    doc.use_key_dictionary();
+
+    EXPECT_TRUE(doc.uses_key_dictionary());
+    EXPECT_EQ(doc.get_type(), ObjectType::DictionaryMap);
+    EXPECT_EQ(doc.get_size(), 2);
+    EXPECT_LT(doc.data().size(), original.data().size() * 3 / 4);
+    EXPECT_EQ(doc.str(), original.str());
+    EXPECT_TRUE(doc.valid());
+
+    EXPECT_EQ(Document(doc, "total").as_integer(), 50);
+    EXPECT_EQ(Document(doc, "items.7.count").as_integer(), 7);
+    EXPECT_EQ(Document(doc, "items.7.name").as_string(), "item7");
+    EXPECT_FALSE(Document(doc, "items.7.size").valid());
+    EXPECT_FALSE(Document(doc, "size").valid());
+
+    // Maps and arrays bring along the keys they refer to
+    const Document item(doc, "items.3");
+    EXPECT_EQ(item.str(), "{\"name\":\"item3\",\"count\":3,"
+                          "\"tags\":{\"count\":true}}");
+    EXPECT_EQ(doc.get_child(0).get_size(), 50);
+    EXPECT_EQ(Document(doc.get_child(0), 40).get_key(1), "count");
+    EXPECT_EQ(doc.get_key(1), "total");
+
+    const std::vector<std::vector<std::string>> projections = {
+        {"items.2.name", "total"}, {"items.1.tags"}};
+
+    for (auto &paths : projections) {
+        EXPECT_EQ(Document(doc, paths).str(), Document(original, paths).str());
+    }
+
+    EXPECT_TRUE(doc.matches_predicates(Document("{\"items.9.count\": 9}")));
+    EXPECT_FALSE(doc.matches_predicates(Document("{\"items.9.count\": 8}")));
+
+    EXPECT_TRUE(doc.add("total", Integer(1)));
+    EXPECT_EQ(Document(doc, "total").as_integer(), 51);
+    EXPECT_FALSE(doc.insert("extra", Document("1")));
+
+    doc.use_key_dictionary(false);
+    EXPECT_FALSE(doc.uses_key_dictionary());
+    EXPECT_EQ(Document(doc, "total").as_integer(), 51);
+}
+
+TEST(Search, compiled_path) {
+    auto doc = Document::parse(
+        "{\"a\":{\"b\":[10,{\"c\":\"x\"},[true]]},\"ab\":1,\"10\":null,"
+        "\"d\":{\"01\":2,\"1\":3}}");
+
+    const std::vector<std::string> paths = {
+        "",      "a",     "a.b",    "a.b.0", "a.b.1.c", "a.b.2.0",
+        "ab",    "10",    "d.01",   "d.1",   "a.b.3",   "a.b.01",
+        "a.c",   "ab.x",  "a.b.x",  "x"};
+
+    auto with_keys = doc.duplicate(true);
+    with_keys.use_key_dictionary();
+
+    auto sorted = doc.duplicate(true);
+    sorted.sort_map_keys(1);
+
+    for (auto *document : {&doc, &with_keys, &sorted}) {
+        for (const auto &path : paths) {
+            Document expected(*document, path);
+            Document actual(*document, Path(path));
+
+            EXPECT_EQ(actual.valid(), expected.valid()) << path;
+            EXPECT_EQ(actual.str(), expected.str()) << path;
+        }
+    }
+
+    // Views point into the document
+    Document view(doc, Path("a.b.1.c"));
+    const auto *begin = doc.data().data();
+    EXPECT_GT(view.data().data(), begin);
+    EXPECT_LT(view.data().data(), begin + doc.byte_size());
+    EXPECT_TRUE(Document(doc, Path("a.b.2.0")).as_boolean());
+
+    EXPECT_THROW(Document(doc, Path("a.x"), true), json_error);
+    EXPECT_THROW(Path("a..b"), json_error);
+    EXPECT_THROW(Path("a.*"), json_error);
+
+    // Of several equal keys, the last one that has the rest of the path is
+    // used, as with Search
+    const std::vector<std::string> duplicate_paths = {"a", "a.c", "b", "b.c",
+                                                      "b.d"};
+    auto duplicates = Document::parse(
+        "{\"a\":1,\"b\":{\"c\":2},\"a\":{\"c\":3},\"b\":{\"d\":4}}");
+
+    auto duplicate_keys = duplicates.duplicate(true);
+    duplicate_keys.use_key_dictionary();
+
+    auto duplicates_sorted = duplicates.duplicate(true);
+    duplicates_sorted.sort_map_keys(1);
+
+    for (auto *document :
+         {&duplicates, &duplicate_keys, &duplicates_sorted}) {
+        auto results = document->lookup(PathSet(duplicate_paths));
+
+        for (size_t i = 0; i < duplicate_paths.size(); ++i) {
+            const auto &path = duplicate_paths[i];
+            Document expected(duplicates, path);
+            Document actual(*document, Path(path));
+
+            EXPECT_EQ(Document(*document, path).str(), expected.str()) << path;
+            EXPECT_EQ(actual.str(), expected.str()) << path;
+            EXPECT_EQ(results[i].str(), expected.str()) << path;
+        }
+    }
+
+    EXPECT_EQ(Document(duplicates, Path("a.c")).as_integer(), 3);
+    EXPECT_EQ(Document(duplicates, Path("b.c")).as_integer(), 2);
+
+    Writer writer;
+    writer.start_map();
+    writer.write_floats("v", std::vector<json::float_t>{1.5, 2.5});
+    writer.end_map();
+    auto typed = writer.make_document();
+
+    EXPECT_EQ(Document(typed, Path("v.1")).as_float(), 2.5);
+    EXPECT_FALSE(Document(typed, Path("v.2")).valid());
+    EXPECT_FALSE(Document(typed, Path("v.1.x")).valid());
+}
+
+TEST(Search, lookup) {
+    auto doc = Document::parse(
+        "{\"a\":{\"b\":[10,{\"c\":\"x\"},[true]]},\"ab\":1,\"10\":null,"
+        "\"d\":{\"01\":2,\"1\":3},\"ab\":4}");
+
+    const std::vector<std::string> paths = {
+        "a.b.1.c", "",     "a",     "a.b", "a.b.0",   "a.b.2.0",
+        "ab",      "10",   "d.01",  "d.1", "a.b.3",   "a.b.01",
+        "a.c",     "ab.x", "a.b.x", "x",   "a.b.1.c", "a.b.1"};
+    const PathSet set(paths);
+
+    auto with_keys = doc.duplicate(true);
+    with_keys.use_key_dictionary();
+
+    auto sorted = doc.duplicate(true);
+    sorted.sort_map_keys(1);
+
+    for (auto *document : {&doc, &with_keys, &sorted}) {
+        auto results = document->lookup(set);
+        ASSERT_EQ(results.size(), paths.size());
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            Document expected(*document, Path(paths[i]));
+
+            EXPECT_EQ(results[i].valid(), expected.valid()) << paths[i];
+            EXPECT_EQ(results[i].str(), expected.str()) << paths[i];
+        }
+    }
+
+    Writer writer;
+    writer.start_map();
+    writer.write_integers("v", std::vector<integer_t>{7, 8});
+    writer.end_map();
+    auto typed = writer.make_document();
+
+    auto results = typed.lookup(PathSet({"v.1", "v.2", "v", "v.0"}));
+    EXPECT_EQ(results[0].as_integer(), 8);
+    EXPECT_TRUE(results[1].empty());
+    EXPECT_EQ(results[2].str(), "[7,8]");
+    EXPECT_EQ(results[3].as_integer(), 7);
+}
+
+TEST(Search, path_index) {
+    auto doc = Document::parse(
+        "{\"a\":{\"b\":[10,{\"c\":\"x\"},[true]]},\"ab\":1,\"10\":null,"
+        "\"d\":{\"01\":2,\"1\":3}}");
+
+    const std::vector<std::string> paths = {
+        "",    "a",    "a.b",   "a.b.0", "a.b.1.c", "a.b.2.0",
+        "ab",  "10",   "d.01",  "d.1",   "a.b.3",   "a.b.01",
+        "a.c", "ab.x", "a.b.x", "x"};
+
+    auto with_keys = doc.duplicate(true);
+    with_keys.use_key_dictionary();
+
+    auto sorted = doc.duplicate(true);
+    sorted.sort_map_keys(1);
+
+    for (auto *document : {&doc, &with_keys, &sorted}) {
+        std::vector<std::string> expected;
+
+        for (const auto &path : paths) {
+            expected.push_back(Document(*document, path).str());
+        }
+
+        EXPECT_FALSE(document->has_path_index());
+        EXPECT_EQ(document->path_index_memory(), 0U);
+
+        document->build_path_index();
+        EXPECT_TRUE(document->has_path_index());
+        EXPECT_GT(document->path_index_memory(), 0U);
+
+        for (size_t i = 0; i < paths.size(); ++i) {
+            EXPECT_EQ(Document(*document, paths[i]).str(), expected[i])
+                << paths[i];
+            EXPECT_EQ(Document(*document, Path(paths[i])).str(), expected[i])
+                << paths[i];
+        }
+    }
+
+    EXPECT_THROW(Document(doc, "a.x", true), json_error);
+    EXPECT_TRUE(doc.matches_predicates(Document("{\"d.1\":3}")));
+    EXPECT_FALSE(doc.matches_predicates(Document("{\"d.1\":4}")));
+
+    // Changes drop the index, but reading the content does not
+    doc.insert("ab", Document("5"));
+    EXPECT_FALSE(doc.has_path_index());
+    EXPECT_EQ(Document(doc, "ab").as_integer(), 5);
+
+    doc.build_path_index();
+    EXPECT_GT(doc.data().size(), 0U);
+    EXPECT_TRUE(doc.has_path_index());
+
+    doc.mutable_data();
+    EXPECT_FALSE(doc.has_path_index());
+
+    Writer writer;
+    writer.write_floats(std::vector<json::float_t>{1.5, 2.5});
+    auto typed = writer.make_document();
+
+    typed.build_path_index();
+    EXPECT_EQ(Document(typed, "1").as_float(), 2.5);
+    EXPECT_FALSE(Document(typed, "2").valid());
+}
+
+TEST(Search, path_index_duplicate_keys) {
+    const std::string text =
+        "{\"a\":1,\"b\":{\"c\":2},\"a\":{\"c\":3},\"b\":{\"d\":4},\"a\":5}";
+    const Document plain(text);
+
+    Document indexed(text);
+    indexed.build_path_index();
+
+    for (std::string path : {"a", "a.c", "b", "b.c", "b.d"}) {
+        EXPECT_EQ(Document(indexed, path).str(), Document(plain, path).str())
+            << path;
+        EXPECT_EQ(Document(indexed, Path(path)).str(),
+                  Document(plain, Path(path)).str())
+            << path;
+    }
+
+    EXPECT_EQ(Document(indexed, "a").as_integer(), 5);
+
+    for (std::string predicate :
+         {"{\"a\":5}", "{\"a\":1}", "{\"a.c\":3}", "{\"b.c\":2}",
+          "{\"b.d\":4}", "{\"b\":{\"d\":4}}"}) {
+        const Document predicates(predicate);
+
+        EXPECT_EQ(indexed.matches_predicates(predicates),
+                  plain.matches_predicates(predicates))
+            << predicate;
+    }
+
+    EXPECT_TRUE(indexed.matches_predicates(Document("{\"a\":5}")));
+}
@@ -0,0 +1,118 @@
+#include <json/json.h>
+
+#include <gtest/gtest.h>
+
+using namespace json;
+
+class StreamParserTest : public testing::Test {};
+
+namespace {
+
+const std::string INPUT =
+    "{\"name\": \"es\\\"caped \\ud83d\\ude00\", \"values\": [1, -2.5e3, true, "
+    "false, null, [], {}], \"nested\": {\"when\": d\"2020-01-02 03:04:05\", "
+    "\"big\": 1234567890123}}";
+
+std::vector<Document> parse_chunked(const std::string &input,
+                                    size_t chunk_size) {
+    StreamParser parser;
+    std::vector<Document> result;
+
+    for (size_t pos = 0; pos < input.size(); pos += chunk_size) {
+        parser.feed(input.data() + pos,
+                    std::min(chunk_size, input.size() - pos));
+
+        while (parser.has_document()) {
+            result.push_back(parser.next_document());
+        }
+    }
+
+    parser.finish();
+
+    while (parser.has_document()) {
+        result.push_back(parser.next_document());
+    }
+
+    return result;
+}
+
+} // namespace
+
+TEST(StreamParserTest, split_at_every_position) {
+    const Document expected(INPUT);
+
+    for (size_t split = 0; split < INPUT.size(); ++split) {
+        StreamParser parser;
+        parser.feed(INPUT.substr(0, split));
+        EXPECT_FALSE(parser.has_document());
+
+        parser.feed(INPUT.substr(split));
+        ASSERT_TRUE(parser.has_document()) << split;
+        EXPECT_EQ(parser.next_document(), expected) << split;
+        EXPECT_FALSE(parser.has_document());
+    }
+}
+
+TEST(StreamParserTest, single_bytes) {
+    auto docs = parse_chunked(INPUT, 1);
+
+    ASSERT_EQ(docs.size(), 1U);
+    EXPECT_EQ(docs[0], Document(INPUT));
+}
+
+TEST(StreamParserTest, multiple_documents) {
+    const std::string input = "{\"a\":1}\n[2, 3] 42 \"str\"\ntrue -1.5";
+
+    for (size_t chunk_size : {1, 3, 7, 100}) {
+        auto docs = parse_chunked(input, chunk_size);
+
+        ASSERT_EQ(docs.size(), 6U);
+        EXPECT_EQ(docs[0], Document("{\"a\":1}"));
+        EXPECT_EQ(docs[1], Document("[2,3]"));
+        EXPECT_EQ(docs[2].as_integer(), 42);
+        EXPECT_EQ(docs[3].as_string(), "str");
+        EXPECT_TRUE(docs[4].as_boolean());
+        EXPECT_EQ(docs[5].as_float(), -1.5);
+    }
+}
+
+TEST(StreamParserTest, number_continues_in_next_chunk) {
+    StreamParser parser;
+    parser.feed("12");
+    parser.feed("34");
+    EXPECT_FALSE(parser.has_document());
+
+    parser.finish();
+    ASSERT_TRUE(parser.has_document());
+    EXPECT_EQ(parser.next_document().as_integer(), 1234);
+}
+
+TEST(StreamParserTest, invalid_input) {
+    const std::vector<std::string> inputs = {"[1,]", "{\"a\" 1}", "[}",
+                                             "{\"a\":tru}", "\"\\q\"", "]"};
+
+    for (auto &input : inputs) {
+        StreamParser parser;
+        EXPECT_THROW(
+            {
+                parser.feed(input);
+                parser.finish();
+            },
+            json_parse_error)
+            << input;
+    }
+}
+
+TEST(StreamParserTest, incomplete_input) {
+    for (std::string input : {"[1, 2", "{\"a\":", "\"abc", "d\"2020-"}) {
+        StreamParser parser;
+        parser.feed(input);
+
+        try {
+            parser.finish();
+            ADD_FAILURE() << input;
+        } catch (const json_parse_error &e) {
+            EXPECT_EQ(e.code(), ParseErrorCode::UnexpectedEnd) << input;
+        }
+    }
+}
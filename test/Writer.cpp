@@ -3,6 +3,8 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+
 using namespace json;
 
 class WriterTest : public testing::Test {};
@@ -22,3 +24,196 @@ TEST(WriterTest, empty) {
     EXPECT_TRUE(doc1.valid());
     EXPECT_TRUE(doc2.valid());
 }
+
+TEST(WriterTest, sorted_map) {
+    Writer writer;
+    writer.set_sorted_map_threshold(3);
+
+    writer.start_map();
+    writer.start_map("small");
+    writer.write_integer("b", 1);
+    writer.write_integer("a", 2);
+    writer.end_map();
+    writer.write_string("c", "x");
+    writer.start_map("forced");
+    writer.end_sorted_map();
+    writer.end_map();
+
+    auto doc = writer.make_document();
+
+    EXPECT_EQ(doc.get_type(), ObjectType::SortedMap);
+    EXPECT_EQ(Document(doc, "small").get_type(), ObjectType::Map);
+    EXPECT_EQ(Document(doc, "forced").get_type(), ObjectType::SortedMap);
+    EXPECT_EQ(doc.str(),
+              "{\"small\":{\"b\":1,\"a\":2},\"c\":\"x\",\"forced\":{}}");
+    EXPECT_EQ(Document(doc, "c").as_string(), "x");
+    EXPECT_EQ(Document(doc, "small.a").as_integer(), 2);
+}
+
+TEST(WriterTest, key_dictionary) {
+    Writer writer;
+    writer.set_key_dictionary(true);
+
+    writer.start_map();
+    writer.start_array("list");
+
+    for (int i = 0; i < 3; ++i) {
+        writer.start_map();
+        writer.write_integer("id", i);
+        writer.write_string("name", "x");
+        writer.end_map();
+    }
+
+    writer.end_array();
+    writer.write_null("id");
+    writer.end_map();
+
+    auto doc = writer.make_document();
+
+    EXPECT_TRUE(doc.uses_key_dictionary());
+    EXPECT_EQ(doc.get_type(), ObjectType::DictionaryMap);
+    EXPECT_EQ(doc.str(), "{\"list\":[{\"id\":0,\"name\":\"x\"},{\"id\":1,"
+                         "\"name\":\"x\"},{\"id\":2,\"name\":\"x\"}],"
+                         "\"id\":null}");
+    EXPECT_EQ(Document(doc, "list.2.id").as_integer(), 2);
+
+    // Documents without maps do not need a dictionary
+    Writer plain;
+    plain.set_key_dictionary(true);
+    plain.start_array();
+    plain.write_integer(1);
+    plain.end_array();
+
+    auto array = plain.make_document();
+    EXPECT_FALSE(array.uses_key_dictionary());
+    EXPECT_EQ(array.str(), "[1]");
+}
+
+TEST(WriterTest, typed_array) {
+    const std::vector<integer_t> integers = {3, -1, 4, 1, 5};
+    const std::vector<json::float_t> floats = {0.5, 2.5};
+
+    Writer writer;
+    writer.start_map();
+    writer.write_string("name", "x");
+    writer.write_integers("vec", integers);
+    writer.write_floats("weights", floats);
+    writer.write_integers("empty", std::span<const integer_t>());
+    writer.end_map();
+
+    auto doc = writer.make_document();
+
+    EXPECT_EQ(doc.str(), "{\"name\":\"x\",\"vec\":[3,-1,4,1,5],"
+                         "\"weights\":[0.500000,2.500000],\"empty\":[]}");
+
+    auto vec = Document(doc, "vec");
+    EXPECT_EQ(vec.get_type(), ObjectType::TypedArray);
+    EXPECT_EQ(vec.get_size(), 5);
+    EXPECT_EQ(vec.get_child(2).as_integer(), 4);
+    EXPECT_EQ(Document(doc, "vec.4").as_integer(), 5);
+    EXPECT_EQ(Document(doc, "weights.1").as_float(), 2.5);
+    EXPECT_EQ(Document(doc, "empty").get_size(), 0);
+
+    auto span = vec.as_integer_span();
+    EXPECT_EQ(std::vector<integer_t>(span.begin(), span.end()), integers);
+    EXPECT_EQ(Document(doc, "weights").as_float_span()[1], 2.5);
+    EXPECT_THROW(vec.as_float_span(), json_error);
+
+    auto projected = Document(doc, std::vector<std::string>{"vec.1"});
+    EXPECT_EQ(projected.str(), "{\"vec\":[-1]}");
+
+    // Values stay aligned when the document is re-encoded
+    auto with_keys = doc.duplicate(true);
+    with_keys.use_key_dictionary();
+    EXPECT_EQ(with_keys.str(), doc.str());
+    EXPECT_EQ(Document(with_keys, "vec").as_integer_span()[3], 1);
+
+    bitstream compact;
+    doc.to_compact(compact);
+    auto decoded = Document::from_compact(compact.data(), compact.size());
+    EXPECT_EQ(decoded.str(), doc.str());
+    EXPECT_EQ(Document(decoded, "weights").as_float_span()[0], 0.5);
+}
+
+TEST(WriterTest, typed_array_copies) {
+    const std::vector<integer_t> integers = {7, -2, 9};
+    const std::vector<json::float_t> floats = {0.25, -1.5};
+
+    // Shift the arrays, so that copies of them start at every offset
+    for (size_t shift = 1; shift <= 8; ++shift) {
+        Writer writer;
+        writer.start_map();
+        writer.write_string(std::string(shift, 'k'), "x");
+        writer.write_integers("vec", integers);
+        writer.write_floats("weights", floats);
+        writer.end_map();
+
+        auto doc = writer.make_document();
+
+        auto copy = Document(doc, "vec").duplicate(true);
+        auto span = copy.as_integer_span();
+        EXPECT_EQ(std::vector<integer_t>(span.begin(), span.end()), integers)
+            << shift;
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(span.data()) % 8, 0U);
+
+        bitstream compressed;
+        Document(doc, "weights").compress(compressed);
+        compressed.move_to(0);
+
+        Document loaded(compressed);
+        auto float_span = loaded.as_float_span();
+        EXPECT_EQ(std::vector<json::float_t>(float_span.begin(),
+                                             float_span.end()),
+                  floats)
+            << shift;
+
+        // Repeated calls return the same values
+        EXPECT_EQ(loaded.as_float_span().data(), float_span.data());
+    }
+}
+
+TEST(WriterTest, summarize) {
+    std::vector<integer_t> integers;
+    std::vector<json::float_t> floats;
+
+    for (int size = 0; size < 67; ++size) {
+        integers.push_back((size * 7919) % 201 - 100);
+        floats.push_back(size % 5 == 3 ? NAN : integers.back() * 0.25);
+
+        auto int_summary = summarize(std::span<const integer_t>(integers));
+        auto float_summary =
+            summarize(std::span<const json::float_t>(floats));
+
+        integer_t sum = 0;
+        integer_t min = INT64_MAX;
+        integer_t max = INT64_MIN;
+
+        for (auto value : integers) {
+            sum += value;
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+
+        EXPECT_EQ(int_summary.sum, sum);
+        EXPECT_EQ(int_summary.min, min);
+        EXPECT_EQ(int_summary.max, max);
+        EXPECT_EQ(int_summary.count, integers.size());
+
+        json::float_t float_sum = 0;
+        json::float_t float_max = -INFINITY;
+        size_t count = 0;
+
+        for (auto value : floats) {
+            if (!std::isnan(value)) {
+                float_sum += value;
+                float_max = std::max(float_max, value);
+                ++count;
+            }
+        }
+
+        // Quarters add up exactly in any order
+        EXPECT_EQ(float_summary.sum, float_sum);
+        EXPECT_EQ(float_summary.max, float_max);
+        EXPECT_EQ(float_summary.count, count);
+    }
+}
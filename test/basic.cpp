@@ -3,6 +3,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 using namespace json;
 
 class Basic : public testing::Test {};
@@ -24,6 +26,27 @@ TEST(Basic, invalid) {
     EXPECT_FALSE(invalid.valid());
 }
 
+TEST(Basic, parse_string_view) {
+    std::string_view input = "{\"a\":[1,2,{\"b\":\"c\"}]}";
+
+    EXPECT_EQ(Document::parse(input), Document(std::string(input)));
+}
+
+TEST(Basic, parse_buffer) {
+    // Only the first part of the buffer holds the document
+    const char buffer[] = "[1,2,3]456";
+    auto doc = Document::parse(buffer, 7);
+
+    EXPECT_EQ(doc.str(), "[1,2,3]");
+}
+
+TEST(Basic, parse_number_at_buffer_end) {
+    const char buffer[] = {'1', '2', '3', '4'};
+    auto doc = Document::parse(buffer, 2);
+
+    EXPECT_EQ(doc.as_integer(), 12);
+}
+
 TEST(Basic, spaces) {
     Document doc1("{\"a\" :1}");
     Document doc2("{\"a\": 1}");
@@ -47,6 +70,118 @@ TEST(Basic, compress_two) {
     EXPECT_EQ(input2.str(), output2.str());
 }
 
+TEST(Basic, compact) {
+    const std::string text =
+        "{\"id\":7,\"n\":-1,\"big\":-9223372036854775807,"
+        "\"wide\":72057594037927936,\"f\":0.5,\"pi\":3.14159,"
+        "\"s\":\"short\",\"long\":\"" +
+        std::string(40, 'x') +
+        "\",\"when\":d\"2020-02-29T23:59:58.25+01:30\","
+        "\"flags\":[true,false,null],\"empty\":{}}";
+
+    Document doc(text);
+
+    bitstream compact;
+    doc.to_compact(compact);
+
+    EXPECT_LT(compact.size(), doc.data().size() * 2 / 3);
+
+    auto output = Document::from_compact(compact.data(), compact.size());
+    EXPECT_EQ(output, doc);
+
+    // Every prefix is rejected instead of being read out of bounds
+    for (uint32_t i = 0; i < compact.size(); ++i) {
+        EXPECT_THROW(Document::from_compact(compact.data(), i), json_error);
+    }
+
+    // Dictionaries and sorted maps are written like regular maps
+    Document keyed(text);
+    keyed.use_key_dictionary();
+
+    bitstream compact_keyed;
+    keyed.to_compact(compact_keyed);
+    EXPECT_EQ(compact_keyed, compact);
+
+    compact << static_cast<uint8_t>(0);
+    EXPECT_THROW(Document::from_compact(compact.data(), compact.size()),
+                 json_error);
+}
+
+TEST(Basic, validate) {
+    std::string text = "{\"list\":[";
+
+    for (int i = 0; i < 20; ++i) {
+        text += (i > 0 ? ",{\"id\":" : "{\"id\":") + std::to_string(i) +
+                ",\"name\":\"n" + std::to_string(i) + "\",\"ok\":true}";
+    }
+
+    text += "],\"when\":d\"2020-02-29T23:59:58+01:30\",\"f\":0.5,"
+            "\"k0\":1,\"k1\":2,\"k2\":3,\"k3\":4,\"k4\":5,\"k5\":6,"
+            "\"k6\":7,\"k7\":8,\"k8\":9,\"k9\":10,\"k10\":11,"
+            "\"k11\":12,\"k12\":13,\"k13\":14,\"k14\":15}";
+
+    auto plain = Document::parse(text);
+
+    auto sorted = plain.duplicate(true);
+    sorted.sort_map_keys();
+
+    auto keyed = plain.duplicate(true);
+    keyed.use_key_dictionary();
+
+    Writer writer;
+    writer.start_map();
+    writer.write_integers("v", std::vector<integer_t>{1, 2, 3});
+    writer.end_map();
+    auto typed = writer.make_document();
+
+    for (auto *doc : {&plain, &sorted, &keyed, &typed}) {
+        EXPECT_FALSE(doc->trusted());
+        EXPECT_TRUE(doc->validate());
+        EXPECT_TRUE(doc->trusted());
+
+        const auto &data = doc->data();
+
+        // Every prefix is rejected
+        for (uint32_t i = 0; i < data.size(); ++i) {
+            Document prefix(data.data(), i, DocumentMode::ReadOnly);
+            EXPECT_FALSE(prefix.validate());
+        }
+
+        // Documents with corrupted bytes are either rejected or readable
+        bitstream copy;
+        copy.write_raw_data(data.data(), data.size());
+
+        for (uint32_t i = 0; i < copy.size(); ++i) {
+            const uint8_t original = copy.data()[i];
+
+            for (uint8_t value : {0x00, 0x01, 0x0f, 0x7f, 0xff}) {
+                copy.data()[i] = value;
+
+                Document corrupted(copy.data(), copy.size(),
+                                   DocumentMode::ReadOnly);
+
+                // The content may make no sense, but reading it stays
+                // within the buffer
+                if (corrupted.validate()) {
+                    try {
+                        corrupted.str();
+                    } catch (const json_error &) {
+                    }
+                }
+            }
+
+            copy.data()[i] = original;
+        }
+    }
+
+    // Changes drop the mark
+    plain.insert("f", Document("1"));
+    EXPECT_FALSE(plain.trusted());
+    EXPECT_TRUE(plain.validate());
+
+    EXPECT_FALSE(Document().validate());
+}
+
 TEST(Basic, binary) {
     const auto length = 1235;
     uint8_t value[length];
@@ -60,6 +195,7 @@ TEST(Basic, binary) {
     json::Document view(doc, "a.0");
 
     EXPECT_EQ(memcmp(view.as_bitstream().data(), value, length), 0);
+    EXPECT_EQ(view.as_binary_span().size(), length);
 }
 
 TEST(Basic, binary2) {
@@ -90,6 +226,76 @@ TEST(Basic, datetime) {
     EXPECT_EQ(input.str(), str);
 }
 
+TEST(Basic, datetime_iso8601) {
+    Document doc("d\"2020-02-29T23:59:58.25+01:30\"");
+
+    EXPECT_EQ(doc.get_type(), ObjectType::Timestamp);
+    EXPECT_EQ(doc.str(), "d\"2020-02-29 23:59:58.250000+01:30\"");
+
+    // 2020-02-29 22:29:58.25 UTC
+    const auto value = doc.as_timestamp();
+    EXPECT_EQ(value.micros, 1583015398250000);
+    EXPECT_EQ(value.utc_offset, 90);
+
+    EXPECT_EQ(Document(doc.str()), doc);
+    EXPECT_EQ(
+        Document("d\"1969-12-31T23:59:59.9999999Z\"").as_timestamp().micros,
+        -1);
+    EXPECT_EQ(Document("d\"1970-01-02\"").str(),
+              "d\"1970-01-02 00:00:00\"");
+    EXPECT_EQ(Document("d\"2000-01-01 00:00:00-0800\"").str(),
+              "d\"2000-01-01 00:00:00-08:00\"");
+    EXPECT_EQ(Document("d\"2020-1-5T3:04:5\"").str(),
+              "d\"2020-01-05 03:04:05\"");
+
+    for (std::string invalid :
+         {"d\"2021-02-29\"", "d\"2020-13-01\"", "d\"2020-01-01 24:00:00\"",
+          "d\"2020-01-01T10:00\"", "d\"2020-01-01 10:00:00.\"",
+          "d\"2020-01-01 10:00:00+1\"", "d\"20-01-01\"",
+          "d\"2020-001-01\"", "d\"2020-01-01 1::00\""}) {
+        EXPECT_THROW(Document::parse(invalid), json_error) << invalid;
+    }
+}
+
+TEST(Basic, datetime_compact) {
+    Document doc("{\"when\": d\"2020-01-01 10:00:00\"}");
+
+    // Type, key and a map header with one entry
+    EXPECT_EQ(doc.byte_size(), 1 + 2 * sizeof(uint32_t) + sizeof(uint32_t) +
+                                   4 + 1 + TIMESTAMP_SIZE);
+}
+
+TEST(Basic, convert_datetimes) {
+    // Documents written before timestamps hold a whole struct tm
+    tm old_value;
+    memset(&old_value, 0, sizeof(old_value));
+    old_value.tm_year = 1955;
+    old_value.tm_mon = 11;
+    old_value.tm_mday = 5;
+    old_value.tm_hour = 12;
+
+    bitstream data;
+    data << ObjectType::Array << static_cast<uint32_t>(0)
+         << static_cast<uint32_t>(3);
+    data << ObjectType::Datetime << old_value;
+    data << ObjectType::Integer << static_cast<integer_t>(42);
+    data << ObjectType::Datetime << old_value;
+
+    const uint32_t byte_size = data.size() - 1;
+    data.move_to(1);
+    data << byte_size;
+
+    Document doc(data.data(), data.size(), DocumentMode::Copy);
+
+    EXPECT_EQ(doc.get_child(0).as_timestamp().micros,
+              Document("d\"1955-11-05 12:00:00\"").as_timestamp().micros);
+
+    EXPECT_EQ(doc.convert_datetimes(), 2U);
+    EXPECT_EQ(doc, Document("[d\"1955-11-05 12:00:00\", 42, "
+                            "d\"1955-11-05 12:00:00\"]"));
+    EXPECT_EQ(doc.convert_datetimes(), 0U);
+}
+
 TEST(Basic, boolean) {
     Document input("true");
     EXPECT_EQ(input.str(), "true");
@@ -194,6 +400,27 @@ TEST(Basic, get_key) {
     EXPECT_EQ(doc.get_key(1), "b");
 }
 
+TEST(Basic, string_views) {
+    auto doc = Document::parse("{\"a\":42, \"b\": \"foobar\"}");
+
+    const auto key = doc.key_view(1);
+    const auto value = doc.get_child(1).as_string_view();
+
+    EXPECT_EQ(key, "b");
+    EXPECT_EQ(value, "foobar");
+
+    // Both point into the buffer of the document
+    const auto *begin = reinterpret_cast<const char *>(doc.data().data());
+    EXPECT_TRUE(key.data() > begin && key.data() < begin + doc.byte_size());
+    EXPECT_TRUE(value.data() > begin &&
+                value.data() < begin + doc.byte_size());
+
+    EXPECT_THROW(doc.get_child(0).as_string_view(), json_error);
+
+    doc.use_key_dictionary();
+    EXPECT_EQ(doc.key_view(0), "a");
+}
+
 TEST(Basic, get_child) {
     Document doc("{\"a\":42, \"b\": \"foobar\"}");
 
@@ -201,6 +428,135 @@ TEST(Basic, get_child) {
     EXPECT_EQ(doc.get_child(1).as_string(), "foobar");
 }
 
+TEST(Basic, get_child_large) {
+    std::string array = "[";
+    std::string map = "{";
+
+    for (int i = 0; i < 1000; ++i) {
+        array += (i > 0 ? "," : "") + std::to_string(i);
+        map += (i > 0 ? ",\"k" : "\"k") + std::to_string(i) + "\": \"v" +
+               std::to_string(i) + "\"";
+    }
+
+    Document array_doc(array + "]");
+    Document map_doc(map + "}");
+
+    for (uint32_t i = 0; i < 1000; i += 7) {
+        EXPECT_EQ(array_doc.get_child(i).as_integer(), i);
+        EXPECT_EQ(Document(array_doc, i).as_integer(), i);
+        EXPECT_EQ(map_doc.get_key(i), "k" + std::to_string(i));
+        EXPECT_EQ(map_doc.get_child(i).as_string(), "v" + std::to_string(i));
+    }
+
+    // Modifications drop the offsets of the children
+    map_doc.insert("k0", Document("\"a much longer value\""));
+    EXPECT_EQ(map_doc.get_key(0), "k1");
+    EXPECT_EQ(map_doc.get_child(500).as_string(), "v501");
+
+    Document moved(std::move(map_doc));
+    EXPECT_EQ(moved.get_key(999), "k0");
+    EXPECT_EQ(moved.get_child(999).as_string(), "a much longer value");
+}
+
+TEST(Basic, iterate_children) {
+    auto doc = Document::parse(
+        "{\"a\":1,\"b\":[2,3],\"c\":{\"d\":null},\"e\":\"x\"}");
+
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+
+    for (const auto &[key, value] : doc) {
+        keys.emplace_back(key);
+        values.push_back(value.str());
+    }
+
+    EXPECT_EQ(keys, (std::vector<std::string>{"a", "b", "c", "e"}));
+    EXPECT_EQ(values, (std::vector<std::string>{"1", "[2,3]", "{\"d\":null}",
+                                                "\"x\""}));
+
+    auto it = std::find_if(doc.begin(), doc.end(), [](const auto &entry) {
+        return entry.value.get_type() == ObjectType::Map;
+    });
+    ASSERT_NE(it, doc.end());
+    EXPECT_EQ((*it).key, "c");
+    EXPECT_EQ(std::distance(doc.begin(), doc.end()), 4);
+
+    auto array = Document::parse("[5,6,7]");
+    EXPECT_EQ(std::count_if(array.begin(), array.end(),
+                            [](const auto &entry) {
+                                return entry.key.empty() &&
+                                       entry.value.as_integer() > 5;
+                            }),
+              2);
+
+    // Children that refer to the key dictionary are readable on their own
+    doc.use_key_dictionary();
+    values.clear();
+
+    for (const auto &entry : doc) {
+        values.push_back(entry.value.str());
+    }
+
+    EXPECT_EQ(values[2], "{\"d\":null}");
+
+    Writer writer;
+    writer.write_integers(std::vector<integer_t>{8, 9});
+    auto typed = writer.make_document();
+    EXPECT_EQ((*++typed.begin()).value.as_integer(), 9);
+
+    EXPECT_THROW(Document::parse("1").begin(), json_error);
+}
+
+TEST(Basic, iterate_dictionary_children) {
+    std::string text = "[";
+
+    for (int i = 0; i < 20; ++i) {
+        text += (i > 0 ? "," : "") + std::string("{\"id\":") +
+                std::to_string(i) + ",\"tags\":[\"t" + std::to_string(i) +
+                "\"],\"inner\":{\"id\":true}}";
+    }
+
+    text += "]";
+
+    const auto original = Document::parse(text);
+    auto doc = Document::parse(text);
+    doc.use_key_dictionary();
+    ASSERT_TRUE(doc.uses_key_dictionary());
+
+    std::vector<std::string> expected;
+
+    for (const auto &entry : original) {
+        expected.push_back(entry.value.str());
+    }
+
+    std::vector<Document> items;
+
+    for (const auto &[key, value] : doc) {
+        EXPECT_TRUE(key.empty());
+        items.push_back(value.duplicate());
+    }
+
+    ASSERT_EQ(items.size(), expected.size());
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        EXPECT_EQ(items[i].str(), expected[i]);
+
+        std::vector<std::string> keys;
+
+        for (const auto &entry : items[i]) {
+            keys.emplace_back(entry.key);
+        }
+
+        EXPECT_EQ(keys, (std::vector<std::string>{"id", "tags", "inner"}));
+        EXPECT_EQ(Document(items[i], "inner.id").as_boolean(), true);
+    }
+
+    // Copies stay readable after the document is gone
+    auto first = *doc.begin();
+    doc = Document::parse("null");
+    EXPECT_EQ(Document(first.value, "tags.0").as_string(), "t0");
+}
+
 TEST(Basic, add) {
     Document doc("{\"a\":42}");
     Document to_add("5");